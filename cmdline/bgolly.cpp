@@ -134,7 +134,9 @@ struct options {
 } ;
 bigint maxgen = -1, inc = 0 ;
 int maxmem = 256 ;
+int numthreads = 1 ;
 int hyper, render, autofit, quiet, popcount, progress ;
+int incrementalgc, gcstats, stepcaches, rulecaches, calcstats ;
 int hashlife ;
 char *algoName = 0 ;
 int verbose ;
@@ -142,6 +144,7 @@ int timeline ;
 int stepthresh, stepfactor ;
 char *liferule = 0 ;
 char *outfilename = 0 ;
+char *spilldir = 0 ;
 char *renderscale = (char *)"1" ;
 char *testscript = 0 ;
 int outputgzip, outputismc ;
@@ -150,6 +153,13 @@ options options[] = {
   { "-m", "--generation", "How far to run", 'I', &maxgen },
   { "-i", "--stepsize", "Step size", 'I', &inc },
   { "-M", "--maxmemory", "Max memory to use in megabytes", 'i', &maxmem },
+  { "",   "--threads", "Number of threads to use (hashing algorithms and QuickLife)", 'i', &numthreads },
+  { "",   "--incremental", "Reclaim memory incrementally (HashLife)", 'b', &incrementalgc },
+  { "",   "--gcstats", "Show the longest garbage collection pause", 'b', &gcstats },
+  { "",   "--spill-dir", "Keep nodes in a file in this directory (HashLife)", 's', &spilldir },
+  { "",   "--step-caches", "Keep results for this many other step sizes (HashLife)", 'i', &stepcaches },
+  { "",   "--rule-caches", "Keep results for this many other rules (HashLife)", 'i', &rulecaches },
+  { "",   "--calcstats", "Show the rule cache hit rate (multistate hashing)", 'b', &calcstats },
   { "-2", "--exponential", "Use exponentially increasing steps", 'b', &hyper },
   { "-q", "--quiet", "Don't show population; twice, don't show anything", 'b', &quiet },
   { "-r", "--rule", "Life rule to use", 's', &liferule },
@@ -334,7 +344,7 @@ struct loadcmd : public cmdbase {
 struct stepcmd : public cmdbase {
    stepcmd() : cmdbase("step", "b") {}
    virtual void doit() {
-      if (imp->gridwd > 0 || imp->gridht > 0) {
+      if ((imp->gridwd > 0 || imp->gridht > 0) && !imp->handlesBoundedGrid()) {
          // bounded grid, so must step by 1
          imp->setIncrement(1) ;
          if (!imp->CreateBorderCells()) exit(10) ;
@@ -349,6 +359,14 @@ struct stepcmd : public cmdbase {
       cout << imp->getPopulation().tostring() << endl ;
    }
 } step_inst ;
+struct rulecmd : public cmdbase {
+   rulecmd() : cmdbase("rule", "s") {}
+   virtual void doit() {
+      const char *err = imp->setrule(sarg) ;
+      if (err != 0)
+         lifewarning(err) ;
+   }
+} rule_inst ;
 struct showcmd : public cmdbase {
    showcmd() : cmdbase("show", "") {}
    virtual void doit() {
@@ -456,6 +474,15 @@ lifealgo *createUniverse() {
    if (imp == 0)
       lifefatal("Could not create universe") ;
    imp->setMaxMemory(maxmem) ;
+   imp->setThreads(numthreads) ;
+   imp->setIncrementalGC(incrementalgc) ;
+   imp->setStepCaches(stepcaches) ;
+   imp->setRuleCaches(rulecaches) ;
+   if (spilldir) {
+      const char *err = imp->setSpillDir(spilldir) ;
+      if (err)
+         lifefatal(err) ;
+   }
    return imp ;
 }
 
@@ -479,6 +506,12 @@ struct setmaxmemcmd : public cmdbase {
       maxmem = iargs[0] ;
    }
 } setmaxmem_inst ;
+struct setthreadscmd : public cmdbase {
+   setthreadscmd() : cmdbase("setthreads", "i") {}
+   virtual void doit() {
+      numthreads = iargs[0] ;
+   }
+} setthreads_inst ;
 struct setalgocmd : public cmdbase {
    setalgocmd() : cmdbase("setalgo", "s") {}
    virtual void doit() {
@@ -618,7 +651,8 @@ case 's':
       err = imp->setrule(liferule) ;
       if (err) lifefatal(err) ;
    }
-   bool boundedgrid = (imp->gridwd > 0 || imp->gridht > 0) ;
+   bool boundedgrid = (imp->gridwd > 0 || imp->gridht > 0) &&
+                      !imp->handlesBoundedGrid() ;
    if (boundedgrid) {
       hyper = 0 ;
       inc = 1 ;     // only step by 1
@@ -672,5 +706,14 @@ case 's':
    }
    if (maxgen >= 0 && outfilename != 0)
       writepat(-1) ;
+   if (gcstats)
+      cout << "Longest GC pause: " << imp->getMaxGCPause() * 1000.0
+           << " ms" << endl ;
+   if (calcstats) {
+      double lookups = imp->getCalcCacheLookups() ;
+      cout << "Rule cache: " << lookups << " lookups, "
+           << (lookups > 0 ? 100.0 * imp->getCalcCacheHits() / lookups : 0)
+           << "% hits" << endl ;
+   }
    exit(0) ;
 }
@@ -77,6 +77,37 @@ state generationsalgo::slowcalc(state nw, state n, state ne, state w, state c,
    return result ;
 }
 
+// the same for a whole leaf:  we find the live cells of the 4x4 block
+// once and shift each cell's 3x3 index out of them
+void generationsalgo::slowcalc4(const state *b, state *r) {
+   char *lookup = rule0 ;
+   if (alternate_rules && generation.odd()) {
+      lookup = rule1 ;
+   }
+   int rows[4] ;
+   for (int i = 0 ; i < 4 ; i++) {
+      rows[i] = ((b[4*i] == 1) ? 8 : 0) | ((b[4*i+1] == 1) ? 4 : 0)
+              | ((b[4*i+2] == 1) ? 2 : 0) | ((b[4*i+3] == 1) ? 1 : 0) ;
+   }
+   for (int i = 0 ; i < 4 ; i++) {
+      int y = i >> 1 ;
+      int shift = 1 - (i & 1) ;
+      int index = (((rows[y] >> shift) & 7) << 6)
+                | (((rows[y+1] >> shift) & 7) << 3)
+                | ((rows[y+2] >> shift) & 7) ;
+      state c = b[4*y+4+(i&1)+1] ;
+      if (c <= 1 && lookup[index]) {
+         r[i] = 1 ;
+      }
+      else if (c > 0 && c + 1 < maxCellStates) {
+         r[i] = c + 1 ;
+      }
+      else {
+         r[i] = 0 ;
+      }
+   }
+}
+
 static lifealgo *creator() { return new generationsalgo() ; }
 
 void generationsalgo::doInitializeAlgoInfo(staticAlgoInfo &ai) {
@@ -163,6 +194,9 @@ generationsalgo::generationsalgo() {
       order_letters[i + survival_offset] = order_letters[i] ;
    }
 
+   // our slowcalc4() is a few table lookups, cheaper than the cache
+   usecalccache = 0 ;
+
    // initialize
    initRule() ;
 }
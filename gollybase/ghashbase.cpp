@@ -37,6 +37,10 @@ Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
 #include "util.h"
 #include <stdlib.h>
 #include <string.h>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <map>
 using namespace std ;
 /*
  *   Prime hash sizes tend to work best.
@@ -57,7 +61,18 @@ static g_uintptr_t nextprime(g_uintptr_t i) {
  *   call frequently to help us.
  */
 #define ghnode_hash(a,b,c,d) (65537*(g_uintptr_t)(d)+257*(g_uintptr_t)(c)+17*(g_uintptr_t)(b)+5*(g_uintptr_t)(a))
-#define ghleaf_hash(a,b,c,d) (65537*(d)+257*(c)+17*(b)+5*(a))
+/*
+ *   Leaves hash on all 64 of their cells, taken four at a time.
+ */
+static inline g_uintptr_t ghleaf_hash(const state *c) {
+   g_uintptr_t h = 0 ;
+   for (int i=0; i<64; i+=4) {
+      unsigned int w ;
+      memcpy(&w, c + i, 4) ;
+      h = h * 1000003 + w ;
+   }
+   return h ;
+}
 /*
  *   Resize the hash.
  */
@@ -100,8 +115,7 @@ void ghashbase::resize() {
          if (is_ghnode(p)) {
             h = ghnode_hash(p->nw, p->ne, p->sw, p->se) ;
          } else {
-            ghleaf *l = (ghleaf *)p ;
-            h = ghleaf_hash(l->nw, l->ne, l->sw, l->se) ;
+            h = ghleaf_hash(((ghleaf *)p)->cells) ;
          }
          h %= nhashprime ;
          p->next = nhashtab[h] ;
@@ -176,14 +190,21 @@ void ghashbase::rehash_ghnode(ghnode *n) {
    n->next = hashtab[h] ;
    hashtab[h] = n ;
 }
-ghleaf *ghashbase::find_ghleaf(state nw, state ne, state sw, state se) {
+/*
+ *   Leaves are looked up by their cells, which we take from the 8x8
+ *   square at b whose rows are stride apart.
+ */
+ghleaf *ghashbase::find_ghleaf(const state *b, int stride) {
+   state c[64] ;
+   int i ;
+   for (i=0; i<8; i++)
+      memcpy(c + 8 * i, b + stride * i, 8) ;
    ghleaf *p ;
    ghleaf *pred = 0 ;
-   g_uintptr_t h = ghleaf_hash(nw, ne, sw, se) ;
+   g_uintptr_t h = ghleaf_hash(c) ;
    h = h % hashprime ;
    for (p=(ghleaf *)hashtab[h]; p; p = (ghleaf *)p->next) {
-      if (nw == p->nw && ne == p->ne && sw == p->sw && se == p->se &&
-          !is_ghnode(p)) {
+      if (!is_ghnode(p) && memcmp(c, p->cells, 64) == 0) {
          if (pred) {
             pred->next = p->next ;
             p->next = hashtab[h] ;
@@ -194,11 +215,11 @@ ghleaf *ghashbase::find_ghleaf(state nw, state ne, state sw, state se) {
       pred = p ;
    }
    p = newghleaf() ;
-   p->nw = nw ;
-   p->ne = ne ;
-   p->sw = sw ;
-   p->se = se ;
-   p->leafpop = (nw != 0) + (ne != 0) + (sw != 0) + (se != 0) ;
+   memcpy(p->cells, c, 64) ;
+   p->leafpop = 0 ;
+   for (i=0; i<64; i++)
+      if (c[i])
+         p->leafpop++ ;
    p->isghnode = 0 ;
    p->next = hashtab[h] ;
    hashtab[h] = (ghnode *)p ;
@@ -207,6 +228,20 @@ ghleaf *ghashbase::find_ghleaf(state nw, state ne, state sw, state se) {
       resize() ;
    return (ghleaf *)save((ghnode *)p) ;
 }
+/*
+ *   The leaf in the middle of the 16-square that four leaves make.
+ */
+ghnode *ghashbase::centerghleaf(ghnode *nw, ghnode *ne, ghnode *sw,
+                                ghnode *se) {
+   state b[64] ;
+   for (int i=0; i<4; i++) {
+      memcpy(b + 8 * i, ((ghleaf *)nw)->cells + 8 * (i + 4) + 4, 4) ;
+      memcpy(b + 8 * i + 4, ((ghleaf *)ne)->cells + 8 * (i + 4), 4) ;
+      memcpy(b + 8 * (i + 4), ((ghleaf *)sw)->cells + 8 * i + 4, 4) ;
+      memcpy(b + 8 * (i + 4) + 4, ((ghleaf *)se)->cells + 8 * i, 4) ;
+   }
+   return (ghnode *)find_ghleaf(b, 8) ;
+}
 /*
  *   The following routine does the same, but first it checks to see if
  *   the cached result is any good.  If it is, it directly returns that.
@@ -234,21 +269,15 @@ ghnode *ghashbase::getres(ghnode *n, int depth) {
      return zeroghnode(depth-1) ;
    int sp = gsp ;
    depth-- ;
-   if (ngens >= depth) {
-     if (is_ghnode(n->nw)) {
-       res = dorecurs(n->nw, n->ne, n->sw, n->se, depth) ;
-     } else {
-       res = (ghnode *)dorecurs_ghleaf((ghleaf *)n->nw, (ghleaf *)n->ne,
-                                       (ghleaf *)n->sw, (ghleaf *)n->se) ;
-     }
+   if (depth == 2) {
+     res = (ghnode *)dorecurs_ghleaf((ghleaf *)n->nw, (ghleaf *)n->ne,
+                                     (ghleaf *)n->sw, (ghleaf *)n->se) ;
+   } else if (ngens >= depth) {
+     res = dorecurs(n->nw, n->ne, n->sw, n->se, depth) ;
    } else {
      if (halvesdone < 1000)
        halvesdone++ ;
-     if (is_ghnode(n->nw)) {
-       res = dorecurs_half(n->nw, n->ne, n->sw, n->se, depth) ;
-     } else {
-       lifefatal("! can't happen") ;
-     }
+     res = dorecurs_half(n->nw, n->ne, n->sw, n->se, depth) ;
    }
    pop(sp) ;
    if (poller->isInterrupted()) // don't assign this to the cache field!
@@ -296,7 +325,7 @@ ghnode *ghashbase::dorecurs(ghnode *n, ghnode *ne, ghnode *t,
 ghnode *ghashbase::dorecurs_half(ghnode *n, ghnode *ne, ghnode *t,
                                ghnode *e, int depth) {
    int sp = gsp ;
-   if (depth > 1) {
+   if (depth > 3) {
       ghnode
       *t00 = find_ghnode(n->nw->se, n->ne->sw, n->sw->ne, n->se->nw),
       *t01 = find_ghnode(n->ne->se, ne->nw->sw, n->se->ne, ne->sw->nw),
@@ -313,56 +342,157 @@ ghnode *ghashbase::dorecurs_half(ghnode *n, ghnode *ne, ghnode *t,
                       getres(find_ghnode(t11, t12, t21, t22), depth)) ;
    } else {
       ghnode
-      *t00 = getres(n, depth),
-      *t01 = getres(find_ghnode(n->ne, ne->nw, n->se, ne->sw), depth),
-      *t10 = getres(find_ghnode(n->sw, n->se, t->nw, t->ne), depth),
-      *t11 = getres(find_ghnode(n->se, ne->sw, t->ne, e->nw), depth),
-      *t02 = getres(ne, depth),
-      *t12 = getres(find_ghnode(ne->sw, ne->se, e->nw, e->ne), depth),
-      *t20 = getres(t, depth),
-      *t21 = getres(find_ghnode(t->ne, e->nw, t->se, e->sw), depth),
-      *t22 = getres(e, depth) ;
-      n = find_ghnode((ghnode *)find_ghleaf(((ghleaf *)t00)->se,
-                                             ((ghleaf *)t01)->sw,
-                                             ((ghleaf *)t10)->ne,
-                                             ((ghleaf *)t11)->nw),
-                    (ghnode *)find_ghleaf(((ghleaf *)t01)->se,
-                                             ((ghleaf *)t02)->sw,
-                                             ((ghleaf *)t11)->ne,
-                                             ((ghleaf *)t12)->nw),
-                    (ghnode *)find_ghleaf(((ghleaf *)t10)->se,
-                                             ((ghleaf *)t11)->sw,
-                                             ((ghleaf *)t20)->ne,
-                                             ((ghleaf *)t21)->nw),
-                    (ghnode *)find_ghleaf(((ghleaf *)t11)->se,
-                                             ((ghleaf *)t12)->sw,
-                                             ((ghleaf *)t21)->ne,
-                                             ((ghleaf *)t22)->nw)) ;
+      *t00 = centerghleaf(n->nw, n->ne, n->sw, n->se),
+      *t01 = centerghleaf(n->ne, ne->nw, n->se, ne->sw),
+      *t02 = centerghleaf(ne->nw, ne->ne, ne->sw, ne->se),
+      *t10 = centerghleaf(n->sw, n->se, t->nw, t->ne),
+      *t11 = centerghleaf(n->se, ne->sw, t->ne, e->nw),
+      *t12 = centerghleaf(ne->sw, ne->se, e->nw, e->ne),
+      *t20 = centerghleaf(t->nw, t->ne, t->sw, t->se),
+      *t21 = centerghleaf(t->ne, e->nw, t->se, e->sw),
+      *t22 = centerghleaf(e->nw, e->ne, e->sw, e->se) ;
+      n = find_ghnode(getres(find_ghnode(t00, t01, t10, t11), depth),
+                      getres(find_ghnode(t01, t02, t11, t12), depth),
+                      getres(find_ghnode(t10, t11, t20, t21), depth),
+                      getres(find_ghnode(t11, t12, t21, t22), depth)) ;
    }
    pop(sp) ;
    return save(n) ;
 }
 /*
- *   If the ghnode is a 16-ghnode, then the constituents are leaves, so we
- *   need a very similar but still somewhat different subroutine.  Since
- *   we do not (yet) garbage collect leaves, we don't need all that
- *   save/pop mumbo-jumbo.
+ *   A leaf does not repeat nearly as often as the 4x4 squares inside it
+ *   do, so the dense loop below remembers the 2x2 result of each 4x4
+ *   square it computes in a table of 2**WINMEMOBITS entries indexed by
+ *   a hash of the cells; setrule() empties it.  The empty square is
+ *   never stored, so an all-zero entry is an unused one.
+ */
+#define WINMEMOBITS (16)
+struct ghashwinmemo {
+   state w[16] ;
+   state r[4] ;
+} ;
+static inline g_uintptr_t winmemoslot(unsigned long long w0,
+                                      unsigned long long w1) {
+   return (g_uintptr_t)(((w0 * 0x9e3779b97f4a7c15ULL) ^
+                         (w1 * 0xc2b2ae3d27d4eb4fULL)) >> (64 - WINMEMOBITS)) ;
+}
+/*
+ *   Behind that, a table of 2**CALCCACHEBITS entries indexed by a hash
+ *   of the nine cells remembers what slowcalc() said about each
+ *   neighborhood, since a rule usually sees only a small set of them
+ *   even when the 4x4 squares around them all differ.  setrule()
+ *   empties this too.
+ */
+#define CALCCACHEBITS (16)
+struct ghashcalccache {
+   unsigned long long k ;      // the first eight cells, one per byte
+   state k8 ;                  // and the ninth
+   state r ;                   // the new state
+   state used ;
+} ;
+/*
+ *   The new state of the cell at b[5], with rows four apart.
+ */
+state ghashbase::cachedcalc(const state *b) {
+   unsigned long long k =
+      (unsigned long long)b[0] | ((unsigned long long)b[1] << 8) |
+      ((unsigned long long)b[2] << 16) | ((unsigned long long)b[4] << 24) |
+      ((unsigned long long)b[5] << 32) | ((unsigned long long)b[6] << 40) |
+      ((unsigned long long)b[8] << 48) | ((unsigned long long)b[9] << 56) ;
+   ghashcalccache *m = &calccache[(g_uintptr_t)
+      (((k ^ b[10]) * 0x9e3779b97f4a7c15ULL) >> (64 - CALCCACHEBITS))] ;
+   calclookups++ ;
+   if (m->used && m->k == k && m->k8 == b[10]) {
+      calchits++ ;
+      return m->r ;
+   }
+   m->k = k ;
+   m->k8 = b[10] ;
+   m->r = slowcalc(b[0], b[1], b[2], b[4], b[5], b[6], b[8], b[9], b[10]) ;
+   m->used = 1 ;
+   return m->r ;
+}
+/*
+ *   If the ghnode is a 16-ghnode, then the constituents are leaves, and
+ *   rather than recurse we just run its 256 cells forward with a dense
+ *   loop over slowcalc4(), shrinking the square we compute by a cell on
+ *   each side every generation until only the middle 8x8 is left.  That
+ *   is 2**min(2, ngens) generations, just as a deeper ghnode does
+ *   2**min(depth-1, ngens).
  */
 ghleaf *ghashbase::dorecurs_ghleaf(ghleaf *nw, ghleaf *ne, ghleaf *sw,
                                    ghleaf *se) {
-   return find_ghleaf(
-             slowcalc(nw->nw, nw->ne, ne->nw,
-                      nw->sw, nw->se, ne->sw,
-                      sw->nw, sw->ne, se->nw),
-             slowcalc(nw->ne, ne->nw, ne->ne,
-                      nw->se, ne->sw, ne->se,
-                      sw->ne, se->nw, se->ne),
-             slowcalc(nw->sw, nw->se, ne->sw,
-                      sw->nw, sw->ne, se->nw,
-                      sw->sw, sw->se, se->sw),
-             slowcalc(nw->se, ne->sw, ne->se,
-                      sw->ne, se->nw, se->ne,
-                      sw->se, se->sw, se->se)) ;
+   state a[256], b[256], w[16], z[4] ;
+   state *src = a, *dst = b ;
+   int i, j, k, havez = 0 ;
+   if (winmemo.empty()) {
+      winmemo.resize((size_t)1 << WINMEMOBITS) ;
+      calccache.resize((size_t)1 << CALCCACHEBITS) ;
+   }
+   for (i=0; i<8; i++) {
+      memcpy(a + 16 * i, nw->cells + 8 * i, 8) ;
+      memcpy(a + 16 * i + 8, ne->cells + 8 * i, 8) ;
+      memcpy(a + 16 * (i + 8), sw->cells + 8 * i, 8) ;
+      memcpy(a + 16 * (i + 8) + 8, se->cells + 8 * i, 8) ;
+   }
+   int gens = (ngens >= 2) ? 4 : 1 << ngens ;
+   for (k=gens-1; k>=0; k--) {
+      // k more generations to go after this one, so rows and columns
+      // 4-k through 11+k are all we need
+      for (i=4-k; i<12+k; i+=2)
+         for (j=4-k; j<12+k; j+=2) {
+            const state *p = src + 16 * (i - 1) + j - 1 ;
+            memcpy(w, p, 4) ;
+            memcpy(w + 4, p + 16, 4) ;
+            memcpy(w + 8, p + 32, 4) ;
+            memcpy(w + 12, p + 48, 4) ;
+            unsigned long long w0, w1 ;
+            memcpy(&w0, w, 8) ;
+            memcpy(&w1, w + 8, 8) ;
+            state *q = dst + 16 * i + j ;
+            if ((w0 | w1) == 0) {
+               // empty space is common and always goes the same way
+               if (!havez) {
+                  slowcalc4(w, z) ;
+                  havez = 1 ;
+               }
+               q[0] = z[0] ;
+               q[1] = z[1] ;
+               q[16] = z[2] ;
+               q[17] = z[3] ;
+               continue ;
+            }
+            ghashwinmemo *m = &winmemo[winmemoslot(w0, w1)] ;
+            if (memcmp(m->w, w, 16) != 0) {
+               memcpy(m->w, w, 16) ;
+               if (usecalccache) {
+                  m->r[0] = cachedcalc(w) ;
+                  m->r[1] = cachedcalc(w + 1) ;
+                  m->r[2] = cachedcalc(w + 4) ;
+                  m->r[3] = cachedcalc(w + 5) ;
+               } else {
+                  slowcalc4(w, m->r) ;
+               }
+            }
+            q[0] = m->r[0] ;
+            q[1] = m->r[1] ;
+            q[16] = m->r[2] ;
+            q[17] = m->r[3] ;
+         }
+      state *t = src ;
+      src = dst ;
+      dst = t ;
+   }
+   return find_ghleaf(src + 16 * 4 + 4, 16) ;
+}
+/*
+ *   The four slowcalc() calls for a leaf, through the vtable.
+ */
+void ghashbase::slowcalc4(const state *b, state *r) {
+   r[0] = slowcalc(b[0], b[1], b[2], b[4], b[5], b[6], b[8], b[9], b[10]) ;
+   r[1] = slowcalc(b[1], b[2], b[3], b[5], b[6], b[7], b[9], b[10], b[11]) ;
+   r[2] = slowcalc(b[4], b[5], b[6], b[8], b[9], b[10], b[12], b[13], b[14]) ;
+   r[3] = slowcalc(b[5], b[6], b[7], b[9], b[10], b[11], b[13], b[14], b[15]) ;
 }
 /*
  *   We keep free ghnodes in a linked list for allocation, and we allocate
@@ -393,10 +523,31 @@ ghnode *ghashbase::newghnode() {
    return r ;
 }
 /*
- *   Leaves are the same.
+ *   Leaves are bigger, so they get blocks of their own.
  */
 ghleaf *ghashbase::newghleaf() {
-   return (ghleaf *)newghnode() ;
+   ghleaf *r ;
+   if (freeghleaves == 0) {
+      int i ;
+      freeghleaves = (ghleaf *)calloc(1001, sizeof(ghleaf)) ;
+      if (freeghleaves == 0)
+         lifefatal("Out of memory; try reducing the hash memory limit.") ;
+      alloced += 1001 * sizeof(ghleaf) ;
+      freeghleaves->next = (ghnode *)ghleafblocks ;
+      ghleafblocks = freeghleaves++ ;
+      for (i=0; i<999; i++) {
+         freeghleaves[1].next = (ghnode *)freeghleaves ;
+         freeghleaves++ ;
+      }
+      totalthings += 1000 ;
+   }
+   if (freeghleaves->next == 0 && alloced + 1000 * sizeof(ghleaf) > maxmem &&
+       okaytogc) {
+      do_gc(0) ;
+   }
+   r = freeghleaves ;
+   freeghleaves = (ghleaf *)freeghleaves->next ;
+   return r ;
 }
 /*
  *   Sometimes we want the new ghnode or ghleaf to be automatically cleared
@@ -428,7 +579,13 @@ ghashbase::ghashbase() {
    okaytogc = 0 ;
    totalthings = 0 ;
    ghnodeblocks = 0 ;
+   freeghleaves = 0 ;
+   ghleafblocks = 0 ;
    zeroghnodea = 0 ;
+   mcpieces = 0 ;
+   usecalccache = 1 ;
+   calclookups = 0 ;
+   calchits = 0 ;
 /*
  *   We initialize our universe to be a 16-square.  We are in drawing
  *   mode at this point.
@@ -441,7 +598,7 @@ ghashbase::ghashbase() {
    nonpow2 = 1 ;
    pow2step = 1 ;
    llsize = 0 ;
-   depth = 1 ;
+   depth = 3 ;
    hashed = 0 ;
    popValid = 0 ;
    needPop = 0 ;
@@ -460,6 +617,11 @@ ghashbase::~ghashbase() {
       ghnodeblocks = ghnodeblocks->next ;
       free(r) ;
    }
+   while (ghleafblocks) {
+      ghleaf *r = ghleafblocks ;
+      ghleafblocks = (ghleaf *)ghleafblocks->next ;
+      free(r) ;
+   }
    if (zeroghnodea)
       free(zeroghnodea) ;
    if (stack)
@@ -575,7 +737,7 @@ void ghashbase::pushroot_1() {
  *   Return the depth of this ghnode (2 is 8x8).
  */
 int ghashbase::ghnode_depth(ghnode *n) {
-   int depth = 0 ;
+   int depth = 2 ;
    while (is_ghnode(n)) {
       depth++ ;
       n = n->nw ;
@@ -598,8 +760,10 @@ ghnode *ghashbase::zeroghnode(int depth) {
          zeroghnodea[nzeros++] = 0 ;
    }
    if (zeroghnodea[depth] == 0) {
-      if (depth == 0) {
-         zeroghnodea[depth] = (ghnode *)find_ghleaf(0, 0, 0, 0) ;
+      if (depth == 2) {
+         state z[64] ;
+         memset(z, 0, sizeof(z)) ;
+         zeroghnodea[depth] = (ghnode *)find_ghleaf(z, 8) ;
       } else {
          ghnode *z = zeroghnode(depth-1) ;
          zeroghnodea[depth] = find_ghnode(z, z, z, z) ;
@@ -629,35 +793,16 @@ ghnode *ghashbase::pushroot(ghnode *n) {
  *   the ghnodes can be null.  We'll patch this up in due course.
  */
 ghnode *ghashbase::setbit(ghnode *n, int x, int y, int newstate, int depth) {
-   if (depth == 0) {
+   if (depth == 2) {
       ghleaf *l = (ghleaf *)n ;
+      int i = 8 * (3 - y) + x + 4 ;
       if (hashed) {
-         state nw = l->nw ;
-         state sw = l->sw ;
-         state ne = l->ne ;
-         state se = l->se ;
-         if (x < 0)
-           if (y < 0)
-             sw = (state)newstate ;
-           else
-             nw = (state)newstate ;
-         else
-           if (y < 0)
-             se = (state)newstate ;
-           else
-             ne = (state)newstate ;
-         return save((ghnode *)find_ghleaf(nw, ne, sw, se)) ;
+         state c[64] ;
+         memcpy(c, l->cells, 64) ;
+         c[i] = (state)newstate ;
+         return save((ghnode *)find_ghleaf(c, 8)) ;
       }
-      if (x < 0)
-        if (y < 0)
-          l->sw = (state)newstate ;
-        else
-          l->nw = (state)newstate ;
-      else
-        if (y < 0)
-          l->se = (state)newstate ;
-        else
-          l->ne = (state)newstate ;
+      l->cells[i] = (state)newstate ;
       return (ghnode *)l ;
    } else {
       unsigned int w = 0, wh = 0 ;
@@ -684,7 +829,7 @@ ghnode *ghashbase::setbit(ghnode *n, int x, int y, int newstate, int depth) {
             nptr = &(n->ne) ;
       }
       if (*nptr == 0) {
-         if (depth == 0)
+         if (depth == 2)
             *nptr = (ghnode *)newclearedghleaf() ;
          else
             *nptr = newclearedghnode() ;
@@ -720,18 +865,8 @@ ghnode *ghashbase::setbit(ghnode *n, int x, int y, int newstate, int depth) {
  *   but really not all that complicated.
  */
 int ghashbase::getbit(ghnode *n, int x, int y, int depth) {
-   if (depth == 0) {
-      ghleaf *l = (ghleaf *)n ;
-      if (x < 0)
-         if (y < 0)
-           return l->sw ;
-         else
-           return l->nw ;
-      else
-         if (y < 0)
-           return l->se ;
-         else
-           return l->ne ;
+   if (depth == 2) {
+      return ((ghleaf *)n)->cells[8 * (3 - y) + x + 4] ;
    } else {
       unsigned int w = 0, wh = 0 ;
       if (depth >= 32) {
@@ -768,27 +903,13 @@ int ghashbase::getbit(ghnode *n, int x, int y, int depth) {
 int ghashbase::nextbit(ghnode *n, int x, int y, int depth, int &v) {
    if (n == 0 || n == zeroghnode(depth))
       return -1 ;
-   if (depth == 0) {
-      ghleaf *l = (ghleaf *)n ;
-      if (y < 0) {
-        if (x < 0 && l->sw) {
-          v = l->sw ;
-          return 0 ;
-        }
-        if (l->se) {
-          v = l->se ;
-          return -x ;
-        }
-      } else {
-        if (x < 0 && l->nw) {
-          v = l->nw ;
-          return 0 ;
-        }
-        if (l->ne) {
-          v = l->ne ;
-          return -x ;
-        }
-      }
+   if (depth == 2) {
+      const state *row = ((ghleaf *)n)->cells + 8 * (3 - y) ;
+      for (int i=x+4; i<8; i++)
+         if (row[i]) {
+            v = row[i] ;
+            return i - (x + 4) ;
+         }
       return -1 ; // none found
    } else {
       unsigned int w = 1 << depth ;
@@ -928,11 +1049,11 @@ ghnode *ghashbase::hashpattern(ghnode *root, int depth) {
    ghnode *r ;
    if (root == 0) {
       r = zeroghnode(depth) ;
-   } else if (depth == 0) {
+   } else if (depth == 2) {
       ghleaf *n = (ghleaf *)root ;
-      r = (ghnode *)find_ghleaf(n->nw, n->ne, n->sw, n->se) ;
-      n->next = freeghnodes ;
-      freeghnodes = root ;
+      r = (ghnode *)find_ghleaf(n->cells, 8) ;
+      n->next = (ghnode *)freeghleaves ;
+      freeghleaves = n ;
    } else {
       depth-- ;
       r = find_ghnode(hashpattern(root->nw, depth),
@@ -963,7 +1084,7 @@ void ghashbase::ensure_hashed() {
  */
 ghnode *ghashbase::popzeros(ghnode *n) {
    int depth = ghnode_depth(n) ;
-   while (depth > 1) {
+   while (depth > 3) {
       ghnode *z = zeroghnode(depth-2) ;
       if (n->nw->nw == z && n->nw->ne == z && n->nw->sw == z &&
           n->ne->nw == z && n->ne->ne == z && n->ne->se == z &&
@@ -1008,7 +1129,7 @@ static void sum4(bigint &dest, const bigint &a, const bigint &b,
 const bigint &ghashbase::calcpop(ghnode *root, int depth) {
    if (root == zeroghnode(depth))
       return bigint::zero ;
-   if (depth == 0) {
+   if (depth == 2) {
       root->nw = 0 ;
       bigint &r = *(bigint *)&(root->nw) ;
       ghleaf *n = (ghleaf *)root ;
@@ -1039,7 +1160,7 @@ const bigint &ghashbase::calcpop(ghnode *root, int depth) {
 void ghashbase::aftercalcpop2(ghnode *root, int depth, int cleanbigints) {
    if (root == zeroghnode(depth))
       return ;
-   if (depth == 0) {
+   if (depth == 2) {
       root->nw = 0 ; // all these bigints are guaranteed to be small
       return ;
    }
@@ -1065,6 +1186,105 @@ void ghashbase::calcPopulation(ghnode *root) {
    population = calcpop(root, depth) ;
    aftercalcpop2(root, depth, 1) ;
 }
+/*
+ *   The bounding box of the live cells of a ghnode, as left, top,
+ *   right and bottom in cells from its upper left corner (rows counting
+ *   down, as in the tree), so the edges of the whole pattern come
+ *   straight from the root's.  The edges of ghnodes at least
+ *   EDGEMEMODEPTH deep are kept between calls in a table of
+ *   2**EDGEMEMOBITS entries indexed by a hash of the ghnode, which a
+ *   gc that frees anything empties.  For a root deeper than EDGEMAXDEPTH the offsets
+ *   would not fit in a long long, so nodeedges() returns 0 and
+ *   findedges() and fit() scan the tree level by level instead.
+ */
+#define EDGEMAXDEPTH (61)
+#define EDGEMEMOBITS (12)
+#define EDGEMEMODEPTH (5)
+struct ghashedgememo {
+   ghnode *n ;
+   long long e[4] ;
+} ;
+static inline g_uintptr_t edgememoslot(ghnode *n) {
+   return (g_uintptr_t)(((unsigned long long)(g_uintptr_t)n *
+                         0x9e3779b97f4a7c15ULL) >> (64 - EDGEMEMOBITS)) ;
+}
+/*
+ *   The same distance as nodeedge() below, for a nonempty leaf.
+ */
+static int leafedge(ghleaf *l, int side) {
+   int r = 8 ;
+   for (int i=0; i<64; i++)
+      if (l->cells[i]) {
+         int row = i >> 3, col = i & 7 ;
+         int v = (side == 0) ? col : (side == 1) ? row :
+                 (side == 2) ? 7 - col : 7 - row ;
+         if (v < r)
+            r = v ;
+      }
+   return r ;
+}
+/*
+ *   How far in from one side of a nonempty ghnode its nearest live cell
+ *   is:  side 0 is the left, 1 the top, 2 the right and 3 the bottom.
+ *   As in a scan of that side of the tree, we give up on children that
+ *   cannot come nearer than limit; then we just return something no
+ *   smaller than limit, and only exact answers go into the table.
+ */
+long long ghashbase::nodeedge(ghnode *root, int depth, int side,
+                            long long limit) {
+   ghashedgememo *m = 0 ;
+   if (depth >= EDGEMEMODEPTH) {
+      m = &edgememo[edgememoslot(root)] ;
+      if (m->n == root && m->e[side] >= 0)
+         return m->e[side] ;
+   }
+   depth-- ;
+   long long h = 1LL << (depth + 1), r = limit ;
+   ghnode *z = zeroghnode(depth) ;
+   ghnode *c[4] = { root->nw, root->ne, root->sw, root->se } ;
+   // the two children on that side first, then the two behind them
+   static const int order[4][4] = { { 0, 2, 1, 3 }, { 0, 1, 2, 3 },
+                                    { 1, 3, 0, 2 }, { 2, 3, 0, 1 } } ;
+   int near = 0 ;
+   for (int j=0; j<4; j++) {
+      int i = order[side][j] ;
+      if (c[i] == z)
+         continue ;
+      if (j < 2) {
+         near = 1 ;
+      } else if (near || h >= r) {
+         break ;
+      }
+      long long off = (j < 2) ? 0 : h ;
+      long long v = off + ((depth == 2) ? leafedge((ghleaf *)c[i], side)
+                                    : nodeedge(c[i], depth, side, r - off)) ;
+      if (v < r)
+         r = v ;
+   }
+   if (m == 0 || r >= limit)
+      return r ;
+   m = &edgememo[edgememoslot(root)] ;
+   if (m->n != root) {
+      m->n = root ;
+      m->e[0] = m->e[1] = m->e[2] = m->e[3] = -1 ;
+   }
+   m->e[side] = r ;
+   return r ;
+}
+int ghashbase::nodeedges(ghnode *root, int depth, long long *e) {
+   int i ;
+   if (depth > EDGEMAXDEPTH)
+      return 0 ;
+   if (depth > 2 && edgememo.empty())
+      edgememo.resize((size_t)1 << EDGEMEMOBITS) ;
+   for (i=0; i<4; i++)
+      e[i] = (depth == 2) ? leafedge((ghleaf *)root, i)
+                          : nodeedge(root, depth, i, 1LL << 62) ;
+   // turn the right and bottom distances into columns and rows
+   e[2] = (1LL << (depth + 1)) - 1 - e[2] ;
+   e[3] = (1LL << (depth + 1)) - 1 - e[3] ;
+   return 1 ;
+}
 /*
  *   Is the universe empty?
  */
@@ -1123,6 +1343,170 @@ void ghashbase::gc_mark(ghnode *root, int invalidate) {
       }
    }
 }
+/*
+ *   With more than one thread, a gc marks and sweeps in parallel once
+ *   there are at least this many ghnodes.  This works just like the
+ *   parallel gc in hlifealgo:  threads claim ghnodes by setting the mark
+ *   bit with a compare-and-swap, share work through a common stack, and
+ *   then each sweeps its own range of ghnode blocks, pushing survivors
+ *   onto the hash chains with a compare-and-swap.
+ */
+const g_uintptr_t PARALLEL_GC_NODES = 100000 ;
+struct ghashgc {
+   ghashgc(int n) : nthreads(n), idle(0), done(0), hungry(0),
+                    heads(n), tails(n), leafheads(n), leaftails(n),
+                    freed(n), kept(n) {}
+   std::mutex lock ;
+   std::condition_variable wake ;
+   vector<ghnode *> shared ;
+   int nthreads, idle, done ;
+   volatile int hungry ;
+   int invalidate ;
+   vector<ghnode *> blocks ;
+   vector<ghleaf *> leafblocks ;
+   vector<ghnode *> heads, tails ;
+   vector<ghleaf *> leafheads, leaftails ;
+   vector<g_uintptr_t> freed, kept ;
+} ;
+static inline int gcclaim(ghnode *n) {
+   for (;;) {
+      ghnode *o = n->next ;
+      if (1 & (g_uintptr_t)o)
+         return 0 ;
+      if (g_cas_ptr(&n->next, o, (ghnode *)(1 | (g_uintptr_t)o)))
+         return 1 ;
+   }
+}
+g_uintptr_t ghashbase::gc_par(vector<ghnode *> &roots, int invalidate,
+                              int nthreads) {
+   ghashgc g(nthreads) ;
+   g.invalidate = invalidate ;
+   for (size_t r=0; r<roots.size(); r++)
+      if (gcclaim(roots[r]) && is_ghnode(roots[r]))
+         g.shared.push_back(roots[r]) ;
+   for (ghnode *p=ghnodeblocks; p; p=p->next)
+      g.blocks.push_back(p) ;
+   for (ghleaf *p=ghleafblocks; p; p=(ghleaf *)p->next)
+      g.leafblocks.push_back(p) ;
+   vector<std::thread> threads ;
+   for (int t=1; t<nthreads; t++)
+      threads.push_back(std::thread(&ghashbase::gc_par_thread, this, &g, t)) ;
+   gc_par_thread(&g, 0) ;
+   for (size_t t=0; t<threads.size(); t++)
+      threads[t].join() ;
+   g_uintptr_t freed_ghnodes = 0 ;
+   for (int t=0; t<nthreads; t++) {
+      if (g.heads[t]) {
+         g.tails[t]->next = freeghnodes ;
+         freeghnodes = g.heads[t] ;
+      }
+      if (g.leafheads[t]) {
+         g.leaftails[t]->next = (ghnode *)freeghleaves ;
+         freeghleaves = g.leafheads[t] ;
+      }
+      freed_ghnodes += g.freed[t] ;
+      hashpop += g.kept[t] ;
+   }
+   return freed_ghnodes ;
+}
+void ghashbase::gc_par_thread(ghashgc *g, int t) {
+   vector<ghnode *> todo ;
+   for (;;) {
+      if (todo.empty()) {
+         std::unique_lock<std::mutex> lk(g->lock) ;
+         while (g->shared.empty() && !g->done) {
+            if (++g->idle == g->nthreads) {
+               g->done = 1 ;
+               g->wake.notify_all() ;
+               break ;
+            }
+            g->hungry = 1 ;
+            g->wake.wait(lk) ;
+            g->idle-- ;
+         }
+         if (g->done)
+            break ;
+         size_t k = g->shared.size() > 64 ? g->shared.size() - 64 : 0 ;
+         todo.assign(g->shared.begin() + k, g->shared.end()) ;
+         g->shared.resize(k) ;
+         continue ;
+      }
+      ghnode *n = todo.back() ;
+      todo.pop_back() ;
+      ghnode *c[5] = { n->nw, n->ne, n->sw, n->se, n->res } ;
+      if (c[4] && g->invalidate) {
+         n->res = 0 ;
+         c[4] = 0 ;
+      }
+      for (int i=0; i<5; i++)
+         if (c[i] && gcclaim(c[i]) && is_ghnode(c[i]))
+            todo.push_back(c[i]) ;
+      if (g->hungry && todo.size() > 32) {
+         std::unique_lock<std::mutex> lk(g->lock) ;
+         size_t k = todo.size() / 2 ;
+         g->shared.insert(g->shared.end(), todo.begin(), todo.begin() + k) ;
+         todo.erase(todo.begin(), todo.begin() + k) ;
+         g->hungry = 0 ;
+         g->wake.notify_all() ;
+      }
+   }
+   ghnode *head = 0, *tail = 0 ;
+   g_uintptr_t freed = 0, kept = 0 ;
+   size_t nb = g->blocks.size() ;
+   for (size_t b = nb * t / g->nthreads ; b < nb * (t + 1) / g->nthreads ; b++) {
+      if (t == 0)
+         poller->poll() ;
+      ghnode *pp = g->blocks[b] + 1 ;
+      for (int i=1; i<1001; i++, pp++) {
+         if (marked(pp)) {
+            g_uintptr_t h =
+                      ghnode_hash(pp->nw, pp->ne, pp->sw, pp->se) % hashprime ;
+            ghnode *o ;
+            do {
+               o = hashtab[h] ;
+               pp->next = o ;
+            } while (!g_cas_ptr(hashtab + h, o, pp)) ;
+            kept++ ;
+         } else {
+            if (head == 0)
+               tail = pp ;
+            pp->next = head ;
+            head = pp ;
+            freed++ ;
+         }
+      }
+   }
+   ghleaf *leafhead = 0, *leaftail = 0 ;
+   nb = g->leafblocks.size() ;
+   for (size_t b = nb * t / g->nthreads ; b < nb * (t + 1) / g->nthreads ; b++) {
+      if (t == 0)
+         poller->poll() ;
+      ghleaf *lp = g->leafblocks[b] + 1 ;
+      for (int i=1; i<1001; i++, lp++) {
+         if (marked(lp)) {
+            g_uintptr_t h = ghleaf_hash(lp->cells) % hashprime ;
+            ghnode *o ;
+            do {
+               o = hashtab[h] ;
+               lp->next = o ;
+            } while (!g_cas_ptr(hashtab + h, o, (ghnode *)lp)) ;
+            kept++ ;
+         } else {
+            if (leafhead == 0)
+               leaftail = lp ;
+            lp->next = (ghnode *)leafhead ;
+            leafhead = lp ;
+            freed++ ;
+         }
+      }
+   }
+   g->heads[t] = head ;
+   g->tails[t] = tail ;
+   g->leafheads[t] = leafhead ;
+   g->leaftails[t] = leaftail ;
+   g->freed[t] = freed ;
+   g->kept[t] = kept ;
+}
 /**
  *   If the invalidate flag is set, we want to kill *all* cache entries
  *   and recalculate all leaves.
@@ -1146,36 +1530,62 @@ void ghashbase::do_gc(int invalidate) {
          break ;
    if (i >= 0)
       gc_mark(zeroghnodea[i], 0) ; // never invalidate zeroghnode
-   for (i=0; i<gsp; i++) {
-      poller->poll() ;
-      gc_mark((ghnode *)stack[i], invalidate) ;
-   }
+   vector<ghnode *> roots ;
+   for (i=0; i<gsp; i++)
+      roots.push_back((ghnode *)stack[i]) ;
    for (i=0; i<timeline.framecount; i++)
-      gc_mark((ghnode *)timeline.frames[i], invalidate) ;
+      roots.push_back((ghnode *)timeline.frames[i]) ;
+   int nthreads = 1 ;
+   if (numthreads > 1 && totalthings >= PARALLEL_GC_NODES)
+      nthreads = numthreads ;
+   if (nthreads == 1) {
+      for (size_t r=0; r<roots.size(); r++) {
+         poller->poll() ;
+         gc_mark(roots[r], invalidate) ;
+      }
+   }
    hashpop = 0 ;
    memset(hashtab, 0, sizeof(ghnode *) * hashprime) ;
    freeghnodes = 0 ;
-   for (p=ghnodeblocks; p; p=p->next) {
-      poller->poll() ;
-      for (pp=p+1, i=1; i<1001; i++, pp++) {
-         if (marked(pp)) {
-            g_uintptr_t h = 0 ;
-            if (pp->nw) { /* yes, it's a ghnode */
-               h = ghnode_hash(pp->nw, pp->ne, pp->sw, pp->se) % hashprime ;
+   freeghleaves = 0 ;
+   if (nthreads > 1) {
+      freed_ghnodes = gc_par(roots, invalidate, nthreads) ;
+   } else {
+      for (p=ghnodeblocks; p; p=p->next) {
+         poller->poll() ;
+         for (pp=p+1, i=1; i<1001; i++, pp++) {
+            if (marked(pp)) {
+               g_uintptr_t h =
+                      ghnode_hash(pp->nw, pp->ne, pp->sw, pp->se) % hashprime ;
+               pp->next = hashtab[h] ;
+               hashtab[h] = pp ;
+               hashpop++ ;
             } else {
-               ghleaf *lp = (ghleaf *)pp ;
-               h = ghleaf_hash(lp->nw, lp->ne, lp->sw, lp->se) % hashprime ;
+               pp->next = freeghnodes ;
+               freeghnodes = pp ;
+               freed_ghnodes++ ;
+            }
+         }
+      }
+      for (ghleaf *l=ghleafblocks; l; l=(ghleaf *)l->next) {
+         poller->poll() ;
+         ghleaf *lp = l + 1 ;
+         for (i=1; i<1001; i++, lp++) {
+            if (marked(lp)) {
+               g_uintptr_t h = ghleaf_hash(lp->cells) % hashprime ;
+               lp->next = hashtab[h] ;
+               hashtab[h] = (ghnode *)lp ;
+               hashpop++ ;
+            } else {
+               lp->next = (ghnode *)freeghleaves ;
+               freeghleaves = lp ;
+               freed_ghnodes++ ;
             }
-            pp->next = hashtab[h] ;
-            hashtab[h] = pp ;
-            hashpop++ ;
-         } else {
-            pp->next = freeghnodes ;
-            freeghnodes = pp ;
-            freed_ghnodes++ ;
          }
       }
    }
+   if (freed_ghnodes)
+      edgememo.clear() ;
    inGC = 0 ;
    if (verbose) {
      int perc = (int)(freed_ghnodes / (totalthings / 100)) ;
@@ -1194,18 +1604,16 @@ void ghashbase::do_gc(int invalidate) {
  *   ghnodes we've handled.
  */
 void ghashbase::clearcache(ghnode *n, int depth, int clearto) {
-   if (!marked(n)) {
+   if (depth > 2 && !marked(n)) { // leaves have no cache
       mark(n) ;
-      if (depth > 1) {
-         depth-- ;
-         poller->poll() ;
-         clearcache(n->nw, depth, clearto) ;
-         clearcache(n->ne, depth, clearto) ;
-         clearcache(n->sw, depth, clearto) ;
-         clearcache(n->se, depth, clearto) ;
-         if (n->res)
-            clearcache(n->res, depth, clearto) ;
-      }
+      depth-- ;
+      poller->poll() ;
+      clearcache(n->nw, depth, clearto) ;
+      clearcache(n->ne, depth, clearto) ;
+      clearcache(n->sw, depth, clearto) ;
+      clearcache(n->se, depth, clearto) ;
+      if (n->res)
+         clearcache(n->res, depth, clearto) ;
       if (depth >= clearto)
          n->res = 0 ;
    }
@@ -1216,6 +1624,8 @@ void ghashbase::clearcache(ghnode *n, int depth, int clearto) {
  */
 void ghashbase::clearcache() {
    cacheinvalid = 1 ;
+   winmemo.clear() ;
+   calccache.clear() ;
 }
 /*
  *   Change the ngens value.  Requires us to walk the hash, clearing
@@ -1337,11 +1747,42 @@ ghnode *ghashbase::runpattern() {
    generation += pow2step ;
    return n ;
 }
+/*
+ *   Macrocell files still describe the tree down to 2x2 squares, so
+ *   patterns smaller than a ghnode of leaves get put in the middle of
+ *   one; b is an n-square with rows stride apart.
+ */
+ghnode *ghashbase::rootfromcells(const state *b, int stride, int n) {
+   state c[256] ;
+   memset(c, 0, sizeof(c)) ;
+   for (int i=0; i<n; i++)
+      memcpy(c + 16 * (8 - n / 2 + i) + 8 - n / 2, b + stride * i, n) ;
+   return find_ghnode((ghnode *)find_ghleaf(c, 16),
+                      (ghnode *)find_ghleaf(c + 8, 16),
+                      (ghnode *)find_ghleaf(c + 128, 16),
+                      (ghnode *)find_ghleaf(c + 136, 16)) ;
+}
+/*
+ *   The root or frame that line k of a macrocell file describes.
+ */
+ghnode *ghashbase::macrocellroot(ghnode **ind, const vector<int> &lev,
+                                 const vector<state> &small, g_uintptr_t k) {
+   if (lev[k] > 3)
+      return ind[k] ;
+   if (lev[k] == 3)
+      return rootfromcells(((ghleaf *)ind[k])->cells, 8, 8) ;
+   return rootfromcells(&small[16 * k], 4, lev[k] == 2 ? 4 : 2) ;
+}
 const char *ghashbase::readmacrocell(char *line) {
    int n=0 ;
    g_uintptr_t i=1, nw=0, ne=0, sw=0, se=0, indlen=0 ;
-   int r, d ;
+   int r, d, j, k ;
    ghnode **ind = 0 ;
+   // the level of each line, and the cells of those at levels 1 and 2
+   // as 4x4 squares in rows (a 2x2 square is the top left of its 4x4);
+   // line 0 stands for empty space
+   vector<int> lev(1, 0) ;
+   vector<state> small(16, 0) ;
    root = 0 ;
    while (getline(line, 10000)) {
       if (i >= indlen) {
@@ -1434,9 +1875,10 @@ const char *ghashbase::readmacrocell(char *line) {
 	       g_uintptr_t nodeind = 0 ;
 	       n = sscanf(line+7, "%d %" PRIuPTR, &frameind, &nodeind) ;
 	       if (n != 2 || frameind > MAX_FRAME_COUNT || frameind < 0 ||
-		   nodeind > i || timeline.framecount != frameind)
+		   nodeind >= i || timeline.framecount != frameind)
 		  return "Bad FRAME line" ;
-	       timeline.frames.push_back(ind[nodeind]) ;
+	       timeline.frames.push_back(macrocellroot(ind, lev, small,
+	                                               nodeind)) ;
 	       timeline.framecount++ ;
 	       timeline.end = timeline.next ;
 	       timeline.next += timeline.inc ;
@@ -1463,25 +1905,53 @@ const char *ghashbase::readmacrocell(char *line) {
             return "Parse error in readmacrocell." ;
          if (d < 1)
             return "Oops; bad depth in readmacrocell." ;
+         small.resize(16 * (i + 1), 0) ;
+         state *b = &small[16 * i] ;
          if (d == 1) {
            if (nw >= (g_uintptr_t)maxCellStates || ne >= (g_uintptr_t)maxCellStates ||
                sw >= (g_uintptr_t)maxCellStates || se >= (g_uintptr_t)maxCellStates)
               return "Cell state values too high for this algorithm." ;
-           root = ind[i++] = (ghnode *)find_ghleaf((state)nw, (state)ne,
-                                                   (state)sw, (state)se) ;
-           depth = d - 1 ;
+           b[0] = (state)nw ;
+           b[1] = (state)ne ;
+           b[4] = (state)sw ;
+           b[5] = (state)se ;
          } else {
-           ind[0] = zeroghnode(d-2) ; /* allow zeros to work right */
-           if (nw >= i || ind[nw] == 0 || ne >= i || ind[ne] == 0 ||
-               sw >= i || ind[sw] == 0 || se >= i || ind[se] == 0) {
-             return "Node out of range in readmacrocell." ;
+           g_uintptr_t c[4] = { nw, ne, sw, se } ;
+           for (j=0; j<4; j++)
+             if (c[j] >= i || (c[j] != 0 && lev[c[j]] != d - 1))
+               return "Node out of range in readmacrocell." ;
+           if (d == 2) {
+             for (j=0; j<4; j++) {
+               const state *p = &small[16 * c[j]] ;
+               state *q = b + 8 * (j >> 1) + 2 * (j & 1) ;
+               q[0] = p[0] ;
+               q[1] = p[1] ;
+               q[4] = p[4] ;
+               q[5] = p[5] ;
+             }
+           } else if (d == 3) {
+             state cells[64] ;
+             for (j=0; j<4; j++)
+               for (k=0; k<4; k++)
+                 memcpy(cells + 8 * (4 * (j >> 1) + k) + 4 * (j & 1),
+                        &small[16 * c[j] + 4 * k], 4) ;
+             clearstack() ;
+             ind[i] = (ghnode *)find_ghleaf(cells, 8) ;
+           } else {
+             ind[0] = zeroghnode(d-2) ; /* allow zeros to work right */
+             clearstack() ;
+             ind[i] = find_ghnode(ind[nw], ind[ne], ind[sw], ind[se]) ;
            }
-           clearstack() ;
-           root = ind[i++] = find_ghnode(ind[nw], ind[ne], ind[sw], ind[se]) ;
-           depth = d - 1 ;
          }
+         lev.push_back(d) ;
+         i++ ;
       }
    }
+   if (i > 1) {
+      clearstack() ;
+      root = macrocellroot(ind, lev, small, i - 1) ;
+      depth = ghnode_depth(root) ;
+   }
    if (ind)
       free(ind) ;
    if (root == 0) {
@@ -1498,6 +1968,67 @@ const char *ghashbase::setrule(const char *) {
    clearcache() ;
    return 0 ;
 }
+/**
+ *   The file still goes down to 2x2 squares, so the 2x2 and 4x4 squares
+ *   inside leaves get numbered here, keyed by their cells since they
+ *   are not in the hash.
+ */
+struct ghashmcpieces {
+   map<unsigned int, g_uintptr_t> twos ;
+   map<pair<unsigned long long, unsigned long long>, g_uintptr_t> fours ;
+} ;
+/**
+ *   Number (and with an ostream, write) the n-square (n is 2 or 4) at b
+ *   inside a leaf, rows 8 apart, and return its number.  Like the leaves
+ *   and ghnodes, a square numbered on the first pass is written when the
+ *   second pass gets to its number.
+ */
+static char progressmsg[80] ;
+g_uintptr_t ghashbase::writesmall(std::ostream *os, const state *b, int n) {
+   g_uintptr_t c[4] ;
+   g_uintptr_t *num ;
+   if (n == 2) {
+      c[0] = b[0] ;
+      c[1] = b[1] ;
+      c[2] = b[8] ;
+      c[3] = b[9] ;
+      if ((c[0] | c[1] | c[2] | c[3]) == 0)
+         return 0 ;
+      num = &mcpieces->twos[(unsigned int)(c[0] | (c[1] << 8) | (c[2] << 16) |
+                                           (c[3] << 24))] ;
+   } else {
+      c[0] = writesmall(os, b, 2) ;
+      c[1] = writesmall(os, b + 2, 2) ;
+      c[2] = writesmall(os, b + 16, 2) ;
+      c[3] = writesmall(os, b + 18, 2) ;
+      if ((c[0] | c[1] | c[2] | c[3]) == 0)
+         return 0 ;
+      unsigned int w[4] ;
+      for (int i=0; i<4; i++)
+         memcpy(w + i, b + 8 * i, 4) ;
+      num = &mcpieces->fours[make_pair(w[0] | ((unsigned long long)w[1] << 32),
+                                       w[2] | ((unsigned long long)w[3] << 32))] ;
+   }
+   if (*num == 0) {
+      *num = ++cellcounter ;
+      // note:  we *must* not abort this prescan
+      if (os == 0 && (cellcounter & 4095) == 0)
+         lifeabortprogress(0, "Scanning tree") ;
+   } else if (os == 0 || *num != cellcounter + 1) {
+      return *num ;
+   } else {
+      ++cellcounter ;
+      if ((cellcounter & 4095) == 0) {
+         std::streampos siz = os->tellp() ;
+         sprintf(progressmsg, "File size: %.2f MB", double(siz) / 1048576.0) ;
+         lifeabortprogress(cellcounter/(double)writecells, progressmsg) ;
+      }
+   }
+   if (os)
+      *os << n / 2 << ' ' << c[0] << ' ' << c[1]
+                   << ' ' << c[2] << ' ' << c[3] << '\n' ;
+   return *num ;
+}
 /**
  *   Write out the native macrocell format.  This is the one we use when
  *   we're not interactive and displaying a progress dialog.
@@ -1506,30 +2037,31 @@ g_uintptr_t ghashbase::writecell(std::ostream &os, ghnode *root, int depth) {
    g_uintptr_t thiscell = 0 ;
    if (root == zeroghnode(depth))
       return 0 ;
-   if (depth == 0) {
+   if (depth == 2) {
       if (root->nw != 0)
          return (g_uintptr_t)(root->nw) ;
-   } else {
-      if (marked2(root))
-         return (g_uintptr_t)(root->next) ;
-      unhash_ghnode(root) ;
-      mark2(root) ;
-   }
-   thiscell = ++cellcounter ;
-   if (depth == 0) {
       ghleaf *n = (ghleaf *)root ;
+      g_uintptr_t nw = writesmall(&os, n->cells, 4) ;
+      g_uintptr_t ne = writesmall(&os, n->cells + 4, 4) ;
+      g_uintptr_t sw = writesmall(&os, n->cells + 32, 4) ;
+      g_uintptr_t se = writesmall(&os, n->cells + 36, 4) ;
+      thiscell = ++cellcounter ;
       root->nw = (ghnode *)thiscell ;
-      os << 1 << ' ' << int(n->nw) << ' ' << int(n->ne)
-              << ' ' << int(n->sw) << ' ' << int(n->se) << '\n' ;
-   } else {
-      g_uintptr_t nw = writecell(os, root->nw, depth-1) ;
-      g_uintptr_t ne = writecell(os, root->ne, depth-1) ;
-      g_uintptr_t sw = writecell(os, root->sw, depth-1) ;
-      g_uintptr_t se = writecell(os, root->se, depth-1) ;
-      root->next = (ghnode *)thiscell ;
-      os << depth+1 << ' ' << nw << ' ' << ne
-                    << ' ' << sw << ' ' << se << '\n' ;
+      os << 3 << ' ' << nw << ' ' << ne << ' ' << sw << ' ' << se << '\n' ;
+      return thiscell ;
    }
+   if (marked2(root))
+      return (g_uintptr_t)(root->next) ;
+   unhash_ghnode(root) ;
+   mark2(root) ;
+   thiscell = ++cellcounter ;
+   g_uintptr_t nw = writecell(os, root->nw, depth-1) ;
+   g_uintptr_t ne = writecell(os, root->ne, depth-1) ;
+   g_uintptr_t sw = writecell(os, root->sw, depth-1) ;
+   g_uintptr_t se = writecell(os, root->se, depth-1) ;
+   root->next = (ghnode *)thiscell ;
+   os << depth+1 << ' ' << nw << ' ' << ne
+                 << ' ' << sw << ' ' << se << '\n' ;
    return thiscell ;
 }
 /**
@@ -1541,7 +2073,7 @@ g_uintptr_t ghashbase::writecell_2p1(ghnode *root, int depth) {
    g_uintptr_t thiscell = 0 ;
    if (root == zeroghnode(depth))
       return 0 ;
-   if (depth == 0) {
+   if (depth == 2) {
       if (root->nw != 0)
          return (g_uintptr_t)(root->nw) ;
    } else {
@@ -1550,7 +2082,10 @@ g_uintptr_t ghashbase::writecell_2p1(ghnode *root, int depth) {
       unhash_ghnode(root) ;
       mark2(root) ;
    }
-   if (depth == 0) {
+   if (depth == 2) {
+      ghleaf *n = (ghleaf *)root ;
+      for (int i=0; i<4; i++)
+         writesmall(0, n->cells + 32 * (i >> 1) + 4 * (i & 1), 4) ;
       thiscell = ++cellcounter ;
       // note:  we *must* not abort this prescan
       if ((cellcounter & 4095) == 0)
@@ -1573,24 +2108,31 @@ g_uintptr_t ghashbase::writecell_2p1(ghnode *root, int depth) {
  *   This one writes the cells, but assuming they've already been
  *   numbered, and displaying a progress dialog.
  */
-static char progressmsg[80] ;
 g_uintptr_t ghashbase::writecell_2p2(std::ostream &os, ghnode *root, int depth) {
    g_uintptr_t thiscell = 0 ;
    if (root == zeroghnode(depth))
       return 0 ;
-   if (depth == 0) {
-      if (cellcounter + 1 != (g_uintptr_t)(root->nw))
+   if (depth == 2) {
+      if (cellcounter + 1 > (g_uintptr_t)(root->nw) || isaborted())
          return (g_uintptr_t)(root->nw) ;
+      ghleaf *n = (ghleaf *)root ;
+      g_uintptr_t nw = writesmall(&os, n->cells, 4) ;
+      g_uintptr_t ne = writesmall(&os, n->cells + 4, 4) ;
+      g_uintptr_t sw = writesmall(&os, n->cells + 32, 4) ;
+      g_uintptr_t se = writesmall(&os, n->cells + 36, 4) ;
+      if (!isaborted() &&
+          cellcounter + 1 != (g_uintptr_t)(root->nw)) { // this should never happen
+         lifefatal("Internal in writecell_2p2") ;
+         return (g_uintptr_t)(root->nw) ;
+      }
       thiscell = ++cellcounter ;
       if ((cellcounter & 4095) == 0) {
          std::streampos siz = os.tellp() ;
          sprintf(progressmsg, "File size: %.2f MB", double(siz) / 1048576.0) ;
          lifeabortprogress(thiscell/(double)writecells, progressmsg) ;
       }
-      ghleaf *n = (ghleaf *)root ;
       root->nw = (ghnode *)thiscell ;
-      os << 1 << ' ' << int(n->nw) << ' ' << int(n->ne)
-              << ' ' << int(n->sw) << ' ' << int(n->se) << '\n';
+      os << 3 << ' ' << nw << ' ' << ne << ' ' << sw << ' ' << se << '\n' ;
    } else {
       if (cellcounter + 1 > (g_uintptr_t)(root->next) || isaborted())
          return (g_uintptr_t)(root->next) ;
@@ -1657,6 +2199,7 @@ const char *ghashbase::writeNativeFormat(std::ostream &os, char *comments) {
    writecell(os, root, depth) ;
    */
    /* this is the new two-pass way */
+   mcpieces = new ghashmcpieces ;
    cellcounter = 0 ;
    vector<int> depths(timeline.framecount) ;
    int framestosave = timeline.framecount ;
@@ -1687,6 +2230,8 @@ const char *ghashbase::writeNativeFormat(std::ostream &os, char *comments) {
       }
    }
    writecell_2p2(os, root, depth) ;
+   delete mcpieces ;
+   mcpieces = 0 ;
    /* end new two-pass way */
    if (framestosave) {
      for (int i=0; i<timeline.framecount; i++) {
@@ -44,12 +44,13 @@ struct ghnode {
    ghnode *res ;               /* cache */
 } ;
 /*
- *   Leaves, like the standard hlifealgo leaves.
+ *   Leaves, like the standard hlifealgo leaves, are 8x8 squares; the
+ *   cells are stored in rows from the top.
  */
 struct ghleaf {
    ghnode *next ;              /* hash link */
    ghnode *isghnode ;          /* must always be zero for leaves */
-   state nw, ne, sw, se ;      /* constant */
+   state cells[64] ;           /* constant */
    unsigned short leafpop ;    /* how many set bits */
 } ;
 /*
@@ -57,6 +58,11 @@ struct ghleaf {
  *   returns a zero value.
  */
 #define is_ghnode(n) (((ghnode *)(n))->nw)
+struct ghashgc ;
+struct ghashedgememo ;
+struct ghashmcpieces ;
+struct ghashwinmemo ;
+struct ghashcalccache ;
 /**
  *   Our ghashbase class.  Note that this is an abstract class; you need
  *   to expand specific methods to specialize it for a particular multi-state
@@ -70,6 +76,12 @@ public:
    //  This should be overridden by a deriving class.
    virtual state slowcalc(state nw, state n, state ne, state w, state c,
                           state e, state sw, state s, state se) = 0 ;
+   //  The same for the four center cells of a 4x4 block b, read in rows,
+   //  into r.  The default just calls slowcalc() four times; deriving
+   //  classes can do it with ghashslowcalc4() below so the four calls
+   //  are direct and can be inlined, which saves three virtual calls
+   //  for every leaf we compute.
+   virtual void slowcalc4(const state *b, state *r) ;
    // note that for ghashbase, clearall() releases no memory; it retains
    // the full cache information but just sets the current pattern to
    // the empty pattern.
@@ -86,6 +98,8 @@ public:
    virtual int hyperCapable() { return 1 ; }
    virtual void setMaxMemory(int m) ;
    virtual int getMaxMemory() { return (int)(maxmem >> 20) ; }
+   virtual double getCalcCacheLookups() { return (double)calclookups ; }
+   virtual double getCalcCacheHits() { return (double)calchits ; }
    virtual const char *setrule(const char *) ;
    virtual const char *getrule() { return "" ; }
    virtual void step() ;
@@ -104,15 +118,21 @@ public:
    virtual const char *writeNativeFormat(std::ostream &os, char *comments) ;
    static void doInitializeAlgoInfo(staticAlgoInfo &) ;
    
+protected:
+   //  Whether new leaves look up each cell's neighborhood in a cache
+   //  before calling slowcalc(); on unless a deriving class turns it
+   //  off because its slowcalc() is only a table lookup anyway.
+   int usecalccache ;
+
 private:
 /*
  *   Some globals representing our universe.  The root is the
  *   real root of the universe, and the depth is the depth of the
- *   tree where 2 means that root is a ghleaf, and 3 means that the
- *   children of root are leaves, and so on.  The center of the
- *   root is always coordinate position (0,0), so at startup the
- *   x and y coordinates range from -4..3; in general,
- *   -(2**depth)..(2**depth)-1.  The zeroghnodea is an
+ *   tree where 2 would mean that root is a ghleaf, and 3 means that
+ *   the children of root are leaves, and so on; the root is always
+ *   a ghnode.  The center of the root is always coordinate position
+ *   (0,0), so at startup the x and y coordinates range from -8..7;
+ *   in general, -(2**depth)..(2**depth)-1.  The zeroghnodea is an
  *   array of canonical `empty-space' ghnodes at various depths.
  *   The ngens is an input parameter which is the second power of
  *   the number of generations to run.
@@ -137,6 +157,8 @@ private:
    int okaytogc ;
    g_uintptr_t totalthings ;
    ghnode *ghnodeblocks ;
+   ghleaf *freeghleaves ;
+   ghleaf *ghleafblocks ;
    bigint population ;
    bigint setincrement ;
    bigint pow2step ; // greatest power of two in increment
@@ -156,19 +178,26 @@ private:
    int cacheinvalid ;
    g_uintptr_t cellcounter ; // used when writing
    g_uintptr_t writecells ; // how many to write
+   ghashmcpieces *mcpieces ; // see writesmall() in ghashbase.cpp
    int gccount ; // how many gcs total this pattern
    int gcstep ; // how many gcs this step
+   vector<ghashedgememo> edgememo ; // see nodeedges() in ghashbase.cpp
+   vector<ghashwinmemo> winmemo ; // see dorecurs_ghleaf() in ghashbase.cpp
+   vector<ghashcalccache> calccache ; // see cachedcalc() in ghashbase.cpp
+   unsigned long long calclookups, calchits ;
    static char statusline[] ;
 //
    void resize() ;
    ghnode *find_ghnode(ghnode *nw, ghnode *ne, ghnode *sw, ghnode *se) ;
    void unhash_ghnode(ghnode *n) ;
    void rehash_ghnode(ghnode *n) ;
-   ghleaf *find_ghleaf(state nw, state ne, state sw, state se) ;
+   ghleaf *find_ghleaf(const state *b, int stride) ;
+   ghnode *centerghleaf(ghnode *nw, ghnode *ne, ghnode *sw, ghnode *se) ;
    ghnode *getres(ghnode *n, int depth) ;
    ghnode *dorecurs(ghnode *n, ghnode *ne, ghnode *t, ghnode *e, int depth) ;
    ghnode *dorecurs_half(ghnode *n, ghnode *ne, ghnode *t, ghnode *e, int depth) ;
    ghleaf *dorecurs_ghleaf(ghleaf *n, ghleaf *ne, ghleaf *t, ghleaf *e) ;
+   state cachedcalc(const state *b) ;
    ghnode *newghnode() ;
    ghleaf *newghleaf() ;
    ghnode *newclearedghnode() ;
@@ -185,16 +214,23 @@ private:
    const bigint &calcpop(ghnode *root, int depth) ;
    void aftercalcpop2(ghnode *root, int depth, int cleanbigints) ;
    void calcPopulation(ghnode *root) ;
+   int nodeedges(ghnode *root, int depth, long long *e) ;
+   long long nodeedge(ghnode *root, int depth, int side, long long limit) ;
    ghnode *save(ghnode *n) ;
    void pop(int n) ;
    void clearstack() ;
    void clearcache() ;
    void gc_mark(ghnode *root, int invalidate) ;
    void do_gc(int invalidate) ;
+   g_uintptr_t gc_par(vector<ghnode *> &roots, int invalidate, int nthreads) ;
+   void gc_par_thread(ghashgc *g, int t) ;
    void clearcache(ghnode *n, int depth, int clearto) ;
    void new_ngens(int newval) ;
    int log2(unsigned int n) ;
    ghnode *runpattern() ;
+   ghnode *rootfromcells(const state *b, int stride, int n) ;
+   ghnode *macrocellroot(ghnode **ind, const vector<int> &lev,
+                         const vector<state> &small, g_uintptr_t k) ;
    void clearrect(int x, int y, int w, int h) ;
    void renderbm(int x, int y) ;
    void fill_ll(int d) ;
@@ -203,10 +239,25 @@ private:
    g_uintptr_t writecell(std::ostream &os, ghnode *root, int depth) ;
    g_uintptr_t writecell_2p1(ghnode *root, int depth) ;
    g_uintptr_t writecell_2p2(std::ostream &os, ghnode *root, int depth) ;
+   g_uintptr_t writesmall(std::ostream *os, const state *b, int n) ;
    void drawpixel(int x, int y);
-   void draw4x4_1(state sw, state se, state nw, state ne, int llx, int lly) ;
+   void drawghleaf(ghleaf *l, int llx, int lly, int sw) ;
    void draw4x4_1(ghnode *n, ghnode *z, int llx, int lly) ;
    // AKT: set all pixels to background color
    void killpixels();
 } ;
+/**
+ *   Expand slowcalc4() with a deriving class's own slowcalc().
+ */
+template <class A> inline void ghashslowcalc4(A *a, const state *b,
+                                              state *r) {
+   r[0] = a->A::slowcalc(b[0], b[1], b[2], b[4], b[5], b[6],
+                         b[8], b[9], b[10]) ;
+   r[1] = a->A::slowcalc(b[1], b[2], b[3], b[5], b[6], b[7],
+                         b[9], b[10], b[11]) ;
+   r[2] = a->A::slowcalc(b[4], b[5], b[6], b[8], b[9], b[10],
+                         b[12], b[13], b[14]) ;
+   r[3] = a->A::slowcalc(b[5], b[6], b[7], b[9], b[10], b[11],
+                         b[13], b[14], b[15]) ;
+}
 #endif
@@ -70,33 +70,36 @@ void ghashbase::drawpixel(int x, int y) {
 }
 
 /*
- *   Draw a 4x4 area yielding 1x1, 2x2, or 4x4 pixels.
+ *   Draw a leaf in sw by sw pixels (sw is 2, 4 or 8).  At full size each
+ *   cell gets its own color; otherwise, as for ghnodes, each pixel with
+ *   any live cells under it gets the state 1 color.
  */
-void ghashbase::draw4x4_1(state sw, state se, state nw, state ne,
-                          int llx, int lly) {
-   // sw,se,nw,ne contain cell states (0..255)
+void ghashbase::drawghleaf(ghleaf *l, int llx, int lly, int sw) {
    int i = (pmsize-1+lly) * pmsize - llx;
-   if (pmag > 1) {
-      // store state info
-      if (sw) pixbuf[i] = sw;
-      if (se) pixbuf[i+1] = se;
-      i -= pmsize;
-      if (nw) pixbuf[i] = nw;
-      if (ne) pixbuf[i+1] = ne;
-   } else {
-      // store RGBA info
-      if (sw) {
-         pixRGBAbuf[i] = cellRGBA[sw] ;
-      }
-      if (se) {
-         pixRGBAbuf[i+1] = cellRGBA[se] ;
-      }
-      i -= pmsize ;
-      if (nw) {
-         pixRGBAbuf[i] = cellRGBA[nw] ;
-      }
-      if (ne) {
-         pixRGBAbuf[i+1] = cellRGBA[ne] ;
+   int s = 8 / sw ;
+   for (int y=0; y<sw; y++, i -= pmsize) {
+      // pixel rows go up from the bottom, cell rows down from the top
+      const state *row = l->cells + 8 * (8 - s * (y + 1)) ;
+      for (int x=0; x<sw; x++) {
+         if (s == 1) {
+            state c = row[x] ;
+            if (c == 0)
+               continue ;
+            if (pmag > 1)
+               pixbuf[i+x] = c ;   // store state info
+            else
+               pixRGBAbuf[i+x] = cellRGBA[c] ;
+         } else {
+            int live = 0 ;
+            for (int r=0; r<s && !live; r++)
+               for (int c=0; c<s; c++)
+                  if (row[8 * r + s * x + c]) {
+                     live = 1 ;
+                     break ;
+                  }
+            if (live)
+               pixRGBAbuf[i+x] = state1RGBA ;
+         }
       }
    }
 }
@@ -178,7 +181,7 @@ void ghashbase::drawghnode(ghnode *n, int llx, int lly, int depth, ghnode *z) {
       return ;
    if (n == z) {
       // don't do anything
-   } else if (depth > 0 && sw > 2) {
+   } else if (depth > 2 && sw > 2) {
       z = z->nw ;
       sw >>= 1 ;
       depth-- ;
@@ -194,18 +197,12 @@ void ghashbase::drawghnode(ghnode *n, int llx, int lly, int depth, ghnode *z) {
          drawghnode(n->nw, llx, lly-sw, depth, z) ;
          drawghnode(n->ne, llx-sw, lly-sw, depth, z) ;
       }
-   } else if (depth > 0 && sw == 2) {
+   } else if (depth > 2 && sw == 2) {
       draw4x4_1(n, z->nw, llx, lly) ;
    } else if (sw == 1) {
       drawpixel(-llx, -lly) ;
    } else {
-      struct ghleaf *l = (struct ghleaf *)n ;
-      sw >>= 1 ;
-      if (sw == 1) {
-         draw4x4_1(l->sw, l->se, l->nw, l->ne, llx, lly) ;
-      } else {
-         lifefatal("Can't happen") ;
-      }
+      drawghleaf((ghleaf *)n, llx, lly, sw) ;
    }
 }
 /*
@@ -316,7 +313,7 @@ void ghashbase::draw(viewport &viewarg, liferender &rendererarg) {
       }
    }
    /*  Find the lowest four we need to examine */
-   while (d > 0 && d - mag >= 0 &&
+   while (d > 2 && d - mag >= 0 &&
           (d - mag > 28 || (1 << (d - mag)) > 2 * maxd)) {
       llx = (llx << 1) + llxb[d] ;
       lly = (lly << 1) + llyb[d] ;
@@ -392,31 +389,19 @@ bail:
 }
 static
 int getbitsfromleaves(const vector<ghnode *> &v) {
-  unsigned short nw=0, ne=0, sw=0, se=0 ;
-  int i;
+  int rows = 0, cols = 0 ;
+  int i, j;
   for (i=0; i<(int)v.size(); i++) {
     ghleaf *p = (ghleaf *)v[i] ;
-    nw |= p->nw ;
-    ne |= p->ne ;
-    sw |= p->sw ;
-    se |= p->se ;
+    for (j=0; j<64; j++)
+      if (p->cells[j]) {
+        rows |= 0x80 >> (j >> 3) ;
+        cols |= 0x80 >> (j & 7) ;
+      }
   }
-  int r = 0 ;
-  // horizontal bits are least significant ones
-  unsigned short w = nw | sw ;
-  unsigned short e = ne | se ;
-  // vertical bits are next 8
-  unsigned short n = nw | ne ;
-  unsigned short s = sw | se ;
-  if (w)
-    r |= 512 ;
-  if (e)
-    r |= 256 ;
-  if (n)
-    r |= 2 ;
-  if (s)
-    r |= 1 ;
-  return r ;
+  // vertical bits are least significant ones, top row highest;
+  // horizontal bits are next 8, left column highest
+  return (cols << 8) | rows ;
 }
 
 /**
@@ -451,21 +436,30 @@ void ghashbase::findedges(bigint *ptop, bigint *pleft, bigint *pbottom, bigint *
       *pright = 0 ;
       return ;
    }
+   long long e[4] ;
+   if (nodeedges(root, currdepth, e)) {
+      long long o = 1LL << currdepth ; // rows count down and y is one off
+      *pleft = bigint((G_INT64)(e[0] - o)) ;
+      *ptop = bigint((G_INT64)(e[1] - o + 1)) ;
+      *pright = bigint((G_INT64)(e[2] - o)) ;
+      *pbottom = bigint((G_INT64)(e[3] - o + 1)) ;
+      return ;
+   }
    vector<ghnode *> top, left, bottom, right ;
    top.push_back(root) ;
    left.push_back(root) ;
    bottom.push_back(root) ;
    right.push_back(root) ;
    int topbm = 0, bottombm = 0, rightbm = 0, leftbm = 0 ;
-   while (currdepth >= -2) {
+   while (currdepth >= 0) {
       currdepth-- ;
-      if (currdepth == -1) { // we have ghleaf ghnodes; turn them into bitmasks
+      if (currdepth == 1) { // we have ghleaf ghnodes; turn them into bitmasks
          topbm = getbitsfromleaves(top) & 0xff ;
          bottombm = getbitsfromleaves(bottom) & 0xff ;
          leftbm = getbitsfromleaves(left) >> 8 ;
          rightbm = getbitsfromleaves(right) >> 8 ;
       }
-      if (currdepth == -1) {
+      if (currdepth <= 1) {
           int sz = 1 << (currdepth + 2) ;
           int maskhi = (1 << sz) - (1 << (sz >> 1)) ;
           int masklo = (1 << (sz >> 1)) - 1 ;
@@ -491,7 +485,7 @@ void ghashbase::findedges(bigint *ptop, bigint *pleft, bigint *pbottom, bigint *
           } else {
             leftbm >>= (sz >> 1) ;
           }
-      } else if (currdepth >= 0) {
+      } else {
          ghnode *z = 0 ;
          if (hashed)
             z = zeroghnode(currdepth) ;
@@ -598,10 +592,10 @@ void ghashbase::findedges(bigint *ptop, bigint *pleft, bigint *pbottom, bigint *
    xmax >>= 1 ;
    ymin >>= 1 ;
    ymax >>= 1 ;
-   xmin <<= (currdepth + 3) ;
-   ymin <<= (currdepth + 3) ;
-   xmax <<= (currdepth + 3) ;
-   ymax <<= (currdepth + 3) ;
+   xmin <<= (currdepth + 1) ;
+   ymin <<= (currdepth + 1) ;
+   xmax <<= (currdepth + 1) ;
+   ymax <<= (currdepth + 1) ;
    xmax -= 1 ;
    ymax -= 1 ;
    ymin.mul_smallint(-1) ;
@@ -634,6 +628,8 @@ void ghashbase::fit(viewport &view, int force) {
       view.setmag(MAX_MAG) ;
       return ;
    }
+   long long e[4] ;
+   int exact = nodeedges(root, currdepth, e) ;
    vector<ghnode *> top, left, bottom, right ;
    top.push_back(root) ;
    left.push_back(root) ;
@@ -642,13 +638,40 @@ void ghashbase::fit(viewport &view, int force) {
    int topbm = 0, bottombm = 0, rightbm = 0, leftbm = 0 ;
    while (currdepth >= 0) {
       currdepth-- ;
-      if (currdepth == -1) { // we have ghleaf ghnodes; turn them into bitmasks
+      if (!exact && currdepth == 1) { // ghleaf ghnodes; make bitmasks
          topbm = getbitsfromleaves(top) & 0xff ;
          bottombm = getbitsfromleaves(bottom) & 0xff ;
          leftbm = getbitsfromleaves(left) >> 8 ;
          rightbm = getbitsfromleaves(right) >> 8 ;
       }
-      if (currdepth == -1) {
+      if (exact) {
+         // with the exact edges in hand, the outer half of the last
+         // block on each side has something in it just when the edge
+         // does
+         int b = currdepth + 1 ;
+         ymax += ymax ;
+         if ((e[1] >> b) & 1) {
+            ymax.add_smallint(-2) ;
+            ysize-- ;
+         }
+         ymin += ymin ;
+         if (((e[3] >> b) & 1) == 0) {
+            ymin.add_smallint(2) ;
+            ysize-- ;
+         }
+         xmax += xmax ;
+         if (((e[2] >> b) & 1) == 0) {
+            xmax.add_smallint(-2) ;
+            xsize-- ;
+         }
+         xmin += xmin ;
+         if ((e[0] >> b) & 1) {
+            xmin.add_smallint(2) ;
+            xsize-- ;
+         }
+         xsize *= 2 ;
+         ysize *= 2 ;
+      } else if (currdepth <= 1) {
          int sz = 1 << (currdepth + 2) ;
          int maskhi = (1 << sz) - (1 << (sz >> 1)) ;
          int masklo = (1 << (sz >> 1)) - 1 ;
@@ -680,7 +703,7 @@ void ghashbase::fit(viewport &view, int force) {
          }
          xsize <<= 1 ;
          ysize <<= 1 ;
-      } else if (currdepth >= 0) {
+      } else {
          ghnode *z = 0 ;
          if (hashed)
             z = zeroghnode(currdepth) ;
@@ -38,20 +38,97 @@ Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
 #include <stdlib.h>
 #include <string.h>
 #include <iostream>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <chrono>
+#include <unordered_map>
+#if defined(__AVX2__) && defined(__GNUC__)
+#include <immintrin.h>
+#define HLIFEAVX2
+#endif
+#ifndef _WIN32
+#include <sys/mman.h>
+#include <sys/statvfs.h>
+#include <fcntl.h>
+#include <unistd.h>
+#endif
 using namespace std ;
 /*
- *   Prime hash sizes tend to work best.
+ *   The hash table is open addressed, with a power of two number of
+ *   buckets.  Each bucket is one cache line holding HBSLOTS node
+ *   pointers plus a one-byte tag for each, which holds eight more bits
+ *   of the hash (never zero) so most mismatches are rejected without
+ *   touching the node itself.  The slots of a bucket are filled in
+ *   order, and when a bucket is full we go on to the next one, so a
+ *   search ends at the first empty slot.  Entries are only removed
+ *   by the garbage collector, which either rebuilds the table or (when
+ *   collecting incrementally) closes up behind what it takes out.
  */
-static g_uintptr_t nextprime(g_uintptr_t i) {
-   g_uintptr_t j ;
-   i |= 1 ;
-   for (;; i+=2) {
-      for (j=3; j*j<=i; j+=2)
-         if (i % j == 0)
-            break ;
-      if (j*j > i)
-         return i ;
-   }
+#ifndef HLIFECOMPACT
+typedef node *hslot ;
+#define slotnode(s) (s)
+#define nodeslot(p) (p)
+#define g_cas_slot(p, o, n) g_cas_ptr(p, o, n)
+#else
+typedef unsigned int hslot ;
+#define slotnode(s) hlifedecode(s)
+#define nodeslot(p) hlifeencode(p)
+#define g_cas_slot(p, o, n) g_cas_32(p, o, n)
+#endif
+#define HBSLOTS ((int)(64 / (sizeof(hslot) + 1)))
+struct hlifebucket {
+   hslot slot[HBSLOTS] ;
+   unsigned char tag[64 - HBSLOTS * sizeof(hslot)] ;
+} ;
+#ifdef GOLLY64BIT
+#define HASHMULT ((g_uintptr_t)0x9e3779b97f4a7c15ULL)
+#define HASHBITS 64
+#else
+#define HASHMULT ((g_uintptr_t)0x9e3779b9UL)
+#define HASHBITS 32
+#endif
+#define hashtag(m, shift) ((unsigned char)((m) >> ((shift) - 8)) | 1)
+/*
+ *   When collecting incrementally, the next field of a node in the
+ *   hash holds the number of the last cycle that found it live (from
+ *   bit 2 up), and bit 1 says whether its result has been used since
+ *   a cycle last looked at it.  Bit 0 is left for the marks of the
+ *   tree walking routines further down.
+ */
+#ifndef HLIFECOMPACT
+#define gcword(n) ((g_uintptr_t)(n)->next)
+#define setgcword(n, v) ((n)->next = (node *)(v))
+#else
+#define gcword(n) ((g_uintptr_t)(n)->next.i)
+#define setgcword(n, v) ((n)->next.i = (unsigned int)(v))
+#endif
+#define GCUSED (2)
+#define GCEPOCHMAX ((g_uintptr_t)1 << 29)
+#define gclive(n) ((gcword(n) >> 2) == gcepoch)
+enum { GCIDLE, GCMARK, GCSWEEP } ;
+/*
+ *   We start an incremental cycle when we get within this fraction of
+ *   the memory limit.
+ */
+#define GCHEADROOM (8)
+static double gcclock() {
+   return std::chrono::duration<double>(
+             std::chrono::steady_clock::now().time_since_epoch()).count() ;
+}
+#ifndef HLIFECOMPACT
+#define NODESPERBLOCK (1000)
+#else
+#define NODESPERBLOCK ((int)((1 << HSLABBITS) / sizeof(node)) - 1)
+#endif
+/*
+ *   Get n cleared buckets aligned on a cache line; mem gets what to free.
+ */
+static hlifebucket *allocbuckets(g_uintptr_t n, void *&mem) {
+   mem = calloc(n + 1, sizeof(hlifebucket)) ;
+   if (mem == 0)
+      return 0 ;
+   return (hlifebucket *)(((g_uintptr_t)mem + 63) & ~(g_uintptr_t)63) ;
 }
 /*
  *   Note that all the places we represent 4-squares by short, we use
@@ -87,11 +164,85 @@ static unsigned char shortpop[65536] ;
  *
  *   It's a bit intricate, but it's not really overwhelming.
  */
+/*
+ *   When the rule depends only on a cell and on how many of its eight
+ *   neighbors are on, we don't need the rule table at all:  we can hold
+ *   a whole square of cells in a word, add up the neighbors of all of
+ *   them at once with a few logical operations, and then pick out the
+ *   counts that give birth or survival.  leafbirth and leafsurvive have
+ *   bit n set if a cell with n neighbors is born or survives (or are -1
+ *   if the rule isn't like that, and we use the table).
+ *
+ *   An 8-square is one 64-bit word with a row per byte; a 16-square is
+ *   four of them with a row per 16 bits (or, with AVX2, one 256-bit
+ *   register).  Either way the upper left cell is the most significant
+ *   bit, so shifting a row left by one brings each cell its east
+ *   neighbor.  The cells around the edge get garbage, but we only keep
+ *   the center anyway; each generation loses a ring of cells.
+ *
+ *   The adding up is totalisticnext() in liferules.h.
+ */
+static inline unsigned long long leafgen8(unsigned long long x, int birth,
+                                          int survive) {
+   unsigned long long w = x >> 1, e = x << 1 ;
+   unsigned long long tl = w ^ x ^ e, th = (w & x) | ((w ^ x) & e) ;
+   return totalisticnext(x, tl >> 8, th >> 8, tl << 8, th << 8,
+                   w ^ e, w & e, birth, survive) ;
+}
+/*
+ *   The 4-square at rows and columns 2 through 5 of an 8-square.
+ */
+static inline unsigned short leafcenter8(unsigned long long x) {
+   return (unsigned short)(((x >> 30) & 0xf000) | ((x >> 26) & 0xf00) |
+                           ((x >> 22) & 0xf0) | ((x >> 18) & 0xf)) ;
+}
+/*
+ *   Spread the four bytes of x into the low bytes of four 16-bit fields.
+ */
+static inline unsigned long long leafspread(unsigned long long x) {
+   x = (x | (x << 16)) & 0x0000ffff0000ffffULL ;
+   return (x | (x << 8)) & 0x00ff00ff00ff00ffULL ;
+}
+/*
+ *   Four rows of the 4-square at columns 4 through 7 (shift 8) or 8
+ *   through 11 (shift 4) of a 16-square.
+ */
+static inline unsigned short leafquad16(unsigned long long x, int shift) {
+   x >>= shift ;
+   return (unsigned short)(((x >> 36) & 0xf000) | ((x >> 24) & 0xf00) |
+                           ((x >> 12) & 0xf0) | (x & 0xf)) ;
+}
+#ifdef HLIFEAVX2
+static inline __m256i leafnorth16(__m256i v) { // row i gets row i-1
+   return _mm256_alignr_epi8(v, _mm256_permute2x128_si256(v, v, 0x08), 14) ;
+}
+static inline __m256i leafsouth16(__m256i v) { // row i gets row i+1
+   return _mm256_alignr_epi8(_mm256_permute2x128_si256(v, v, 0x81), v, 2) ;
+}
+#endif
 #define combine9(t00,t01,t02,t10,t11,t12,t20,t21,t22) \
        ((t00) << 15) | ((t01) << 13) | (((t02) << 11) & 0x1000) | \
        (((t10) << 7) & 0x880) | ((t11) << 5) | (((t12) << 3) & 0x110) | \
        (((t20) >> 1) & 0x8) | ((t21) >> 3) | ((t22) >> 5)
 void hlifealgo::leafres(leaf *n) {
+   if (leafbirth >= 0) {
+      unsigned int top, bot ;
+      unpack8x8(n->nw, n->ne, n->sw, n->se, &top, &bot) ;
+      unsigned long long x = ((unsigned long long)top << 32) | bot ;
+      x = leafgen8(x, leafbirth, leafsurvive) ;
+      unsigned short r1 = leafcenter8(x) ;
+      x = leafgen8(x, leafbirth, leafsurvive) ;
+#ifndef HLIFECOMPACT
+      leaf *v = n ;
+#else
+      volatile leaf *v = n ;
+#endif
+      v->res1 = r1 ;
+      v->res2 = leafcenter8(x) ;
+      v->leafpop = shortpop[n->nw] + shortpop[n->ne] +
+                   shortpop[n->sw] + shortpop[n->se] ;
+      return ;
+   }
    unsigned short
    t00 = ruletable[n->nw],
    t01 = ruletable[((n->nw << 2) & 0xcccc) | ((n->ne >> 2) & 0x3333)],
@@ -103,13 +254,19 @@ void hlifealgo::leafres(leaf *n) {
    t20 = ruletable[n->sw],
    t21 = ruletable[((n->sw << 2) & 0xcccc) | ((n->se >> 2) & 0x3333)],
    t22 = ruletable[n->se] ;
-   n->res1 = combine9(t00,t01,t02,t10,t11,t12,t20,t21,t22) ;
-   n->res2 =
-   (ruletable[(t00 << 10) | (t01 << 8) | (t10 << 2) | t11] << 10) |
-   (ruletable[(t01 << 10) | (t02 << 8) | (t11 << 2) | t12] << 8) |
-   (ruletable[(t10 << 10) | (t11 << 8) | (t20 << 2) | t21] << 2) |
-    ruletable[(t11 << 10) | (t12 << 8) | (t21 << 2) | t22] ;
-   n->leafpop = shortpop[n->nw] + shortpop[n->ne] +
+#ifndef HLIFECOMPACT
+   leaf *v = n ;
+#else
+   // another thread may be waiting on leafpop, so it must be set last
+   volatile leaf *v = n ;
+#endif
+   v->res1 = combine9(t00,t01,t02,t10,t11,t12,t20,t21,t22) ;
+   v->res2 =
+   (ruletable2[(t00 << 10) | (t01 << 8) | (t10 << 2) | t11] << 10) |
+   (ruletable2[(t01 << 10) | (t02 << 8) | (t11 << 2) | t12] << 8) |
+   (ruletable2[(t10 << 10) | (t11 << 8) | (t20 << 2) | t21] << 2) |
+    ruletable2[(t11 << 10) | (t12 << 8) | (t21 << 2) | t22] ;
+   v->leafpop = shortpop[n->nw] + shortpop[n->ne] +
                 shortpop[n->sw] + shortpop[n->se] ;
 }
 /*
@@ -119,65 +276,426 @@ void hlifealgo::leafres(leaf *n) {
 #define node_hash(a,b,c,d) (65537*(g_uintptr_t)(d)+257*(g_uintptr_t)(c)+17*(g_uintptr_t)(b)+5*(g_uintptr_t)(a))
 #define leaf_hash(a,b,c,d) (65537*(d)+257*(c)+17*(b)+5*(a))
 /*
- *   Resize the hash.
+ *   Multithreaded stepping.
+ *
+ *   The nine subresults in dorecurs() (and then the four built from
+ *   them) do not depend on each other, so near the top of the tree
+ *   we push them onto a shared task stack where idle threads can
+ *   steal them.  Nodes are still canonical, so it doesn't matter who
+ *   computes what; at worst two threads compute the same result and
+ *   store the same pointer into res.
+ *
+ *   While a multithreaded runpattern() is in progress every thread,
+ *   the calling (main) thread included, works through its own
+ *   hlifeworker: a private root stack for the gc, a private chunk of
+ *   the free list, and a count of nodes it has added to the hash.
+ *   The hash table itself is read without locks; new nodes are pushed
+ *   onto the front of their bucket with a compare-and-swap, and since
+ *   nothing is ever unlinked while threads are running (no move-to-
+ *   front, no gc) a reader can never see a broken chain.
+ *
+ *   Only the main thread gcs, resizes the hash, or calls the poller
+ *   (which may call back into the GUI).  A worker that needs a gc or
+ *   a resize sets syncwanted and parks; the main thread notices at
+ *   its next allocation or while waiting for tasks, waits until every
+ *   worker is parked (at which point all of their live nodes are on
+ *   their stacks, just as in the single-threaded case), and does the
+ *   work with the pool lock held.
+ */
+struct hlifeworker {
+   hlifeworker() : stack(0), gsp(0), stacksize(0), freenodes(0),
+                   hashed(0), ismain(0) {}
+   node **stack ;
+   int gsp, stacksize ;
+   node *freenodes ;      // private chunk of the free list
+   g_uintptr_t hashed ;   // added to the hash since we last told hashpop
+   int ismain ;
+} ;
+struct hlifetask {
+   node *n ;
+   int depth ;
+   int *pending ;         // owner's count of unfinished tasks
+} ;
+static thread_local hlifeworker *curworker ;
+/*
+ *   Subresults of nodes at least this deep are worth handing to
+ *   another thread; below this the bookkeeping costs more than it
+ *   saves.
  */
-void hlifealgo::resize() {
-   g_uintptr_t i, nhashprime = nextprime(2 * hashprime) ;
-   node *p, **nhashtab ;
-   if (alloced > maxmem ||
-       nhashprime * sizeof(node *) > (maxmem - alloced)) {
-      hashlimit = G_MAX ;
+const int PARALLEL_DEPTH = 9 ;
+/*
+ *   How many nodes a thread takes from the shared free list at once.
+ */
+const int FREECHUNK = 1000 ;
+/*
+ *   With more than one thread, a gc marks and sweeps in parallel once
+ *   there are at least this many nodes.
+ */
+const g_uintptr_t PARALLEL_GC_NODES = 100000 ;
+struct hlifepool {
+   hlifepool(hlifealgo *a, int n) : algo(a), workers(n), running(0),
+                                    syncwanted(0), gcwanted(0), quit(0) {
+      workers[0].ismain = 1 ;
+   }
+   hlifealgo *algo ;
+   vector<hlifeworker> workers ;   // workers[0] is the main thread
+   vector<std::thread> threads ;
+   vector<hlifetask> tasks ;
+   std::mutex lock ;
+   std::condition_variable wake ;      // workers wait on this
+   std::condition_variable mainwake ;  // the main thread waits on this
+   int running ;                   // worker threads that are not parked
+   volatile int syncwanted ;       // main thread must gc or resize
+   int gcwanted ;
+   int quit ;
+   void workermain(int i) ;
+   void park(std::unique_lock<std::mutex> &lk) ;
+   void wantsync(std::unique_lock<std::mutex> &lk) ;
+   void sync(std::unique_lock<std::mutex> &lk) ;
+   void runtask(std::unique_lock<std::mutex> &lk, int i) ;
+   void getres(node **q, int nq, int depth) ;
+   void refill() ;
+   void growstack(hlifeworker *w) ;
+} ;
+/*
+ *   The body of each worker thread:  run tasks until told to quit.
+ */
+void hlifepool::workermain(int i) {
+   curworker = &workers[i] ;
+   std::unique_lock<std::mutex> lk(lock) ;
+   running++ ;
+   while (!quit) {
+      if (syncwanted || tasks.empty())
+         park(lk) ;
+      else
+         runtask(lk, (int)tasks.size() - 1) ;
+   }
+   running-- ;
+}
+/*
+ *   A worker with nothing to do (or waiting for a sync) parks here.
+ *   A parked worker holds no node pointers that aren't on its stack.
+ */
+void hlifepool::park(std::unique_lock<std::mutex> &lk) {
+   running-- ;
+   if (syncwanted && running == 0)
+      mainwake.notify_one() ;
+   wake.wait(lk) ;
+   running++ ;
+}
+/*
+ *   Called with the lock held by whichever thread needs a sync; the
+ *   main thread does it right away, a worker parks until it's done.
+ */
+void hlifepool::wantsync(std::unique_lock<std::mutex> &lk) {
+   if (curworker->ismain) {
+      sync(lk) ;
+   } else {
+      syncwanted = 1 ;
+      mainwake.notify_one() ;
+      while (syncwanted)
+         park(lk) ;
+   }
+}
+/*
+ *   Main thread only, with the lock held.  Wait for all workers to
+ *   park, then gc and/or resize the hash on their behalf.
+ */
+void hlifepool::sync(std::unique_lock<std::mutex> &lk) {
+   syncwanted = 1 ;
+   while (running > 0)
+      mainwake.wait(lk) ;
+   for (size_t i=0; i<workers.size(); i++) {
+      algo->hashpop += workers[i].hashed ;
+      workers[i].hashed = 0 ;
+   }
+   if (gcwanted) {
+      algo->do_gc(0) ;
+      gcwanted = 0 ;
+   }
+   if (algo->oldtab && algo->oldcursor > algo->oldmask)
+      algo->finishresize() ;
+   while (algo->hashpop + algo->hashslack > algo->hashlimit)
+      algo->resize() ;
+   syncwanted = 0 ;
+   wake.notify_all() ;
+}
+/*
+ *   Remove task i from the stack and run it, with the lock released
+ *   in the meantime.
+ */
+void hlifepool::runtask(std::unique_lock<std::mutex> &lk, int i) {
+   hlifetask t = tasks[i] ;
+   tasks.erase(tasks.begin() + i) ;
+   lk.unlock() ;
+   algo->getres(t.n, t.depth) ;
+   lk.lock() ;
+   if (--*t.pending == 0) {
+      wake.notify_all() ;
+      mainwake.notify_one() ;
+   }
+}
+/*
+ *   Make sure each of the nodes q[0..nq-1] (all saved on our stack)
+ *   has its result filled in, unless we are interrupted.  We compute
+ *   one ourselves, offer the rest to the other threads, and then help
+ *   out until all of ours are done.  While waiting we only pick up
+ *   tasks no deeper than our own, so the nesting is bounded by the
+ *   depth of the tree.
+ */
+void hlifepool::getres(node **q, int nq, int depth) {
+   node *todo[9] ;
+   int ntodo = 0 ;
+   for (int i=0; i<nq; i++) {
+      if (q[i]->res)
+         continue ;
+      int j ;
+      for (j=0; j<ntodo; j++)
+         if (todo[j] == q[i])
+            break ;
+      if (j == ntodo)
+         todo[ntodo++] = q[i] ;
+   }
+   if (ntodo == 0)
       return ;
+   int pending = 0 ;
+   if (ntodo > 1) {
+      std::unique_lock<std::mutex> lk(lock) ;
+      for (int i=1; i<ntodo; i++) {
+         hlifetask t ;
+         t.n = todo[i] ;
+         t.depth = depth ;
+         t.pending = &pending ;
+         tasks.push_back(t) ;
+      }
+      pending = ntodo - 1 ;
+      wake.notify_all() ;
    }
-   /*
-    *   Don't let the hash table buckets take more than 4% of the
-    *   memory.  If we're starting to strain memory, let the buckets
-    *   fill up a bit more.
-    */
-   if (nhashprime > (maxmem/(25*sizeof(int *)))) {
-      nhashprime = nextprime(maxmem/(25*sizeof(int *))) ;
-      if (nhashprime == hashprime) {
-         hashlimit = G_MAX ;
+   algo->getres(todo[0], depth) ;
+   if (ntodo == 1)
+      return ;
+   hlifeworker *w = curworker ;
+   std::unique_lock<std::mutex> lk(lock) ;
+   while (pending > 0) {
+      if (syncwanted) {
+         if (w->ismain)
+            sync(lk) ;
+         else
+            park(lk) ;
+         continue ;
+      }
+      int i = (int)tasks.size() - 1 ;
+      while (i >= 0 && tasks[i].depth > depth)
+         i-- ;
+      if (i >= 0) {
+         runtask(lk, i) ;
+      } else if (w->ismain) {
+         // keep the user interface alive while the workers grind
+         if (mainwake.wait_for(lk, std::chrono::milliseconds(10)) ==
+                                                  std::cv_status::timeout) {
+            lk.unlock() ;
+            algo->poller->inner_poll() ;
+            lk.lock() ;
+         }
+      } else {
+         park(lk) ;
+      }
+   }
+}
+/*
+ *   Our private free list ran out (or someone wants a sync).  Take
+ *   another chunk from the shared list, growing the heap or asking
+ *   for a gc when the shared list is empty.
+ */
+void hlifepool::refill() {
+   hlifeworker *w = curworker ;
+   std::unique_lock<std::mutex> lk(lock) ;
+   int triedgc = 0 ;
+   for (;;) {
+      algo->hashpop += w->hashed ;
+      w->hashed = 0 ;
+      if (syncwanted || algo->hashpop + algo->hashslack > algo->hashlimit) {
+         wantsync(lk) ;
+         continue ;
+      }
+      if (w->freenodes)
          return ;
+      if (algo->freenodes == 0) {
+         if (!triedgc && algo->okaytogc &&
+             algo->memused(NODESPERBLOCK + 1) > algo->maxmem) {
+            triedgc = 1 ;
+            gcwanted = 1 ;
+            wantsync(lk) ;
+            continue ;
+         }
+         algo->allocblock() ;
       }
+      node *first = algo->freenodes, *last = first ;
+      for (int i=1; i<FREECHUNK && last->next; i++)
+         last = last->next ;
+      algo->freenodes = last->next ;
+      last->next = 0 ;
+      w->freenodes = first ;
+      return ;
+   }
+}
+void hlifepool::growstack(hlifeworker *w) {
+   int nstacksize = w->stacksize * 2 + 100 ;
+   std::unique_lock<std::mutex> lk(lock) ;
+   algo->alloced += sizeof(node *)*(nstacksize-w->stacksize) ;
+   w->stack = (node **)realloc(w->stack, nstacksize * sizeof(node *)) ;
+   if (w->stack == 0)
+     lifefatal("Out of memory (3).") ;
+   w->stacksize = nstacksize ;
+}
+/*
+ *   Start growing the hash.  We allocate a table with twice as many
+ *   buckets, and from then on new nodes go into the new table while
+ *   the entries of the old one are copied over a few buckets at a time
+ *   (see migrate()).  So a resize never walks the whole table at once.
+ *
+ *   The buckets may use up to a quarter of the memory (with a spill
+ *   file, as much as fits, since they're most of what has to); beyond
+ *   that we let the table fill up more, and only grow anyway when it is
+ *   nearly full (open addressing cannot overflow like chaining can).
+ */
+void hlifealgo::resize() {
+   if (oldtab)
+      finishresize() ;
+   g_uintptr_t ncap = 2 * HBSLOTS * (hashmask + 1) ;
+   g_uintptr_t nbytes = (2 * (hashmask + 1) + 1) * sizeof(hlifebucket) ;
+   int mustgrow = (hashpop + hashslack > 15 * (ncap / 2) / 16) ;
+   if (hashshift <= 8) {
+      if (mustgrow)
+         lifefatal("Out of memory (2).") ;
+      hashlimit = 15 * (ncap / 2) / 16 ;
+      return ;
+   }
+   if (!mustgrow && (alloced > maxmem || nbytes > (maxmem - alloced) ||
+                     (spill == 0 && nbytes > maxmem / 4))) {
+      hashlimit = 15 * (ncap / 2) / 16 ;
+      return ;
    }
    if (verbose) {
      strcpy(statusline, "Resizing hash...") ;
      lifestatus(statusline) ;
    }
-   nhashtab = (node **)calloc(nhashprime, sizeof(node *)) ;
-   if (nhashtab == 0) {
+   void *nmem = 0 ;
+   hlifebucket *ntab = allocbuckets(2 * (hashmask + 1), nmem) ;
+   if (ntab == 0) {
+     if (mustgrow)
+        lifefatal("Out of memory (2).") ;
      lifewarning("Out of memory; running in a somewhat slower mode; "
                  "try reducing the hash memory limit after restarting.") ;
-     hashlimit = G_MAX ;
+     hashlimit = 15 * (ncap / 2) / 16 ;
      return ;
    }
-   alloced += sizeof(node *) * (nhashprime - hashprime) ;
-   for (i=0; i<hashprime; i++) {
-      for (p=hashtab[i]; p;) {
-         node *np = p->next ;
-         g_uintptr_t h ;
-         if (is_node(p)) {
-            h = node_hash(p->nw, p->ne, p->sw, p->se) ;
-         } else {
-            leaf *l = (leaf *)p ;
-            h = leaf_hash(l->nw, l->ne, l->sw, l->se) ;
-         }
-         h %= nhashprime ;
-         p->next = nhashtab[h] ;
-         nhashtab[h] = p ;
-         p = np ;
-      }
-   }
-   free(hashtab) ;
-   hashtab = nhashtab ;
-   hashprime = nhashprime ;
-   hashlimit = hashprime ;
+   alloced += nbytes ;
+   oldtab = hashtab ;
+   oldmem = hashmem ;
+   oldmask = hashmask ;
+   oldshift = hashshift ;
+   oldcursor = 0 ;
+   hashtab = ntab ;
+   hashmem = nmem ;
+   hashmask = 2 * hashmask + 1 ;
+   hashshift-- ;
+   hashlimit = 3 * ncap / 4 ;
    if (verbose) {
      strcpy(statusline+strlen(statusline), " done.") ;
      lifestatus(statusline) ;
    }
 }
+/*
+ *   Put a node we know isn't there yet into the current table.  If
+ *   other threads may be inserting too, we have to use compare-and-swap.
+ */
+void hlifealgo::hashinsert(node *p, int shared) {
+   g_uintptr_t m ;
+   if (is_node(p)) {
+      m = HASHMULT * node_hash((node *)p->nw, (node *)p->ne,
+                               (node *)p->sw, (node *)p->se) ;
+   } else {
+      leaf *l = (leaf *)p ;
+      m = HASHMULT * leaf_hash(l->nw, l->ne, l->sw, l->se) ;
+   }
+   unsigned char tag = hashtag(m, hashshift) ;
+   for (g_uintptr_t h = m >> hashshift ; ; h = (h + 1) & hashmask) {
+      hlifebucket *b = hashtab + h ;
+      for (int i=0; i<HBSLOTS; i++) {
+         if (shared) {
+            if (b->slot[i] == 0 &&
+                g_cas_slot(b->slot + i, (hslot)0, nodeslot(p))) {
+               b->tag[i] = tag ;
+               return ;
+            }
+         } else if (b->slot[i] == 0) {
+            b->slot[i] = nodeslot(p) ;
+            b->tag[i] = tag ;
+            return ;
+         }
+      }
+   }
+}
+/*
+ *   Copy the next n buckets of the old table into the new one.  The old
+ *   table is left intact, so lookups may still search it; we free it
+ *   once everything is copied (when multithreaded, only at the next
+ *   point where no other thread can be looking at it).
+ */
+void hlifealgo::migrate(int n) {
+   for (; n > 0 && oldcursor <= oldmask; n--, oldcursor++) {
+      hlifebucket *b = oldtab + oldcursor ;
+      for (int i=0; i<HBSLOTS && b->slot[i]; i++)
+         hashinsert(slotnode(b->slot[i]), parallel) ;
+   }
+}
+void hlifealgo::finishresize() {
+   migrate((int)(oldmask + 1 - oldcursor)) ;
+   free(oldmem) ;
+   alloced -= (oldmask + 2) * sizeof(hlifebucket) ;
+   oldtab = 0 ;
+   oldmem = 0 ;
+}
+/*
+ *   Look in one table (the current one or the one we're moving away
+ *   from) for the node or leaf matching k.  On a miss, b and i point
+ *   at the first empty slot in the probe sequence, where it would go.
+ *   When multithreaded, a slot may have been filled in before its tag,
+ *   so a zero tag always has to be checked the slow way.
+ */
+struct hlifenodekey {
+   node *nw, *ne, *sw, *se ;
+   int same(node *p) const {
+      return nw == p->nw && ne == p->ne && sw == p->sw && se == p->se ;
+   }
+} ;
+struct hlifeleafkey {
+   unsigned short nw, ne, sw, se ;
+   int same(node *p) const {
+      leaf *l = (leaf *)p ;
+      return nw == l->nw && ne == l->ne && sw == l->sw && se == l->se &&
+             !is_node(l) ;
+   }
+} ;
+template <class K>
+static inline node *hashprobe(hlifebucket *tab, g_uintptr_t mask, int shift,
+                              g_uintptr_t m, const K &k,
+                              hlifebucket *&b, int &i) {
+   unsigned char tag = hashtag(m, shift) ;
+   for (g_uintptr_t h = m >> shift ; ; h = (h + 1) & mask) {
+      b = tab + h ;
+      for (i=0; i<HBSLOTS; i++) {
+         hslot s = ((volatile hslot *)b->slot)[i] ;
+         if (s == 0)
+            return 0 ;
+         node *p = slotnode(s) ;
+         unsigned char t = ((volatile unsigned char *)b->tag)[i] ;
+         if ((t == tag || t == 0) && k.same(p))
+            return p ;
+      }
+   }
+}
 /*
  *   These next two routines are (nearly) our only hash table access
  *   routines; we simply look up the passed in information.  If we
@@ -185,88 +703,183 @@ void hlifealgo::resize() {
  *   new node and store it in the hash table, and return that.
  */
 node *hlifealgo::find_node(node *nw, node *ne, node *sw, node *se) {
-   node *p ;
-   g_uintptr_t h = node_hash(nw,ne,sw,se) ;
-   node *pred = 0 ;
-   h = h % hashprime ;
-   for (p=hashtab[h]; p; p = p->next) { /* make sure to compare nw *first* */
-      if (nw == p->nw && ne == p->ne && sw == p->sw && se == p->se) {
-         if (pred) { /* move this one to the front */
-            pred->next = p->next ;
-            p->next = hashtab[h] ;
-            hashtab[h] = p ;
-         }
-         return save(p) ;
+   if (parallel)
+      return find_node_par(nw, ne, sw, se) ;
+   hlifenodekey k = { nw, ne, sw, se } ;
+   g_uintptr_t m = HASHMULT * node_hash(nw,ne,sw,se) ;
+   hlifebucket *b, *ob ;
+   int i, oi ;
+   node *p = hashprobe(hashtab, hashmask, hashshift, m, k, b, i) ;
+   if (p == 0 && oldtab)
+      p = hashprobe(oldtab, oldmask, oldshift, m, k, ob, oi) ;
+   if (p && gcphase) {
+      if (gcphase == GCMARK) {
+         gcshade(p) ;
+      } else if (!gclive(p)) { /* garbage the sweep hasn't reached */
+         gcsweepbucket(b - hashtab) ;
+         p = hashprobe(hashtab, hashmask, hashshift, m, k, b, i) ;
       }
-      pred = p ;
    }
+   if (p)
+      return save(p) ;
+   int gcs = gccount ;
    p = newnode() ;
+   if (gccount != gcs) /* the gc rebuilt the table */
+      hashprobe(hashtab, hashmask, hashshift, m, k, b, i) ;
+   setgcword(p, gcphase ? gcepoch << 2 : 0) ;
    p->nw = nw ;
    p->ne = ne ;
    p->sw = sw ;
    p->se = se ;
    p->res = 0 ;
-   p->next = hashtab[h] ;
-   hashtab[h] = p ;
-   hashpop++ ;
-   if (hashpop > hashlimit)
-      resize() ;
+   b->slot[i] = nodeslot(p) ;
+   b->tag[i] = hashtag(m, hashshift) ;
+   addedone() ;
    return save(p) ;
 }
-void hlifealgo::unhash_node(node *n) {
-   node *p ;
-   g_uintptr_t h = node_hash(n->nw,n->ne,n->sw,n->se) ;
-   node *pred = 0 ;
-   h = h % hashprime ;
-   for (p=hashtab[h]; p; p = p->next) {
-      if (p == n) {
-         if (pred)
-            pred->next = p->next ;
-         else
-            hashtab[h] = p->next ;
-         return ;
+leaf *hlifealgo::find_leaf(unsigned short nw, unsigned short ne,
+                                  unsigned short sw, unsigned short se) {
+   if (parallel)
+      return find_leaf_par(nw, ne, sw, se) ;
+   hlifeleafkey k = { nw, ne, sw, se } ;
+   g_uintptr_t m = HASHMULT * leaf_hash(nw, ne, sw, se) ;
+   hlifebucket *b, *ob ;
+   int i, oi ;
+   node *p = hashprobe(hashtab, hashmask, hashshift, m, k, b, i) ;
+   if (p == 0 && oldtab)
+      p = hashprobe(oldtab, oldmask, oldshift, m, k, ob, oi) ;
+   if (p && gcphase) {
+      if (gcphase == GCMARK) {
+         gcshade(p) ;
+      } else if (!gclive(p)) {
+         gcsweepbucket(b - hashtab) ;
+         p = hashprobe(hashtab, hashmask, hashshift, m, k, b, i) ;
       }
-      pred = p ;
    }
-   lifefatal("Didn't find node to unhash") ;
+   if (p)
+      return (leaf *)save(p) ;
+   int gcs = gccount ;
+   leaf *n = newleaf() ;
+   if (gccount != gcs)
+      hashprobe(hashtab, hashmask, hashshift, m, k, b, i) ;
+   setgcword(n, gcphase ? gcepoch << 2 : 0) ;
+   n->nw = nw ;
+   n->ne = ne ;
+   n->sw = sw ;
+   n->se = se ;
+   newleafres(n) ;
+   n->isnode = 0 ;
+   b->slot[i] = nodeslot((node *)n) ;
+   b->tag[i] = hashtag(m, hashshift) ;
+   addedone() ;
+   return (leaf *)save((node *)n) ;
 }
-void hlifealgo::rehash_node(node *n) {
-   g_uintptr_t h = node_hash(n->nw,n->ne,n->sw,n->se) ;
-   h = h % hashprime ;
-   n->next = hashtab[h] ;
-   hashtab[h] = n ;
+/*
+ *   Bookkeeping after adding an entry:  keep the move to a new table
+ *   going, and start one if we're full (but not in the middle of a
+ *   sweep, which only knows about one table).  This is also where an
+ *   incremental gc gets its share of time.
+ */
+void hlifealgo::addedone() {
+   hashpop++ ;
+   if (oldtab) {
+      migrate(2) ;
+      if (oldcursor > oldmask)
+         finishresize() ;
+   }
+   if (hashpop > hashlimit) {
+      if (gcphase == GCSWEEP)
+         gcfinish() ;
+      if (hashpop > hashlimit)
+         resize() ;
+   }
+   if (gcphase)
+      gcwork(gcpace) ;
 }
-leaf *hlifealgo::find_leaf(unsigned short nw, unsigned short ne,
-                                  unsigned short sw, unsigned short se) {
-   leaf *p ;
-   leaf *pred = 0 ;
-   g_uintptr_t h = leaf_hash(nw, ne, sw, se) ;
-   h = h % hashprime ;
-   for (p=(leaf *)hashtab[h]; p; p = (leaf *)p->next) {
-      if (nw == p->nw && ne == p->ne && sw == p->sw && se == p->se &&
-          !is_node(p)) {
-         if (pred) {
-            pred->next = p->next ;
-            p->next = hashtab[h] ;
-            hashtab[h] = (node *)p ;
+/*
+ *   The multithreaded versions of the above.  A new entry goes into
+ *   the first empty slot with a single compare-and-swap; if someone
+ *   beat us to that slot we just search again (slots are only ever
+ *   filled, so whatever they put there is in front of anything we
+ *   could still be missing).  The old table, if any, is only read.
+ *   Allocating may sync (gc or resize), after which we must start over
+ *   anyway.  Only the main thread copies entries out of the old table.
+ */
+node *hlifealgo::find_node_par(node *nw, node *ne, node *sw, node *se) {
+   hlifenodekey k = { nw, ne, sw, se } ;
+   g_uintptr_t m = HASHMULT * node_hash(nw,ne,sw,se) ;
+   hlifebucket *b, *ob ;
+   int i, oi ;
+   node *p, *n = 0 ;
+   for (;;) {
+      p = hashprobe(hashtab, hashmask, hashshift, m, k, b, i) ;
+      if (p == 0 && oldtab)
+         p = hashprobe(oldtab, oldmask, oldshift, m, k, ob, oi) ;
+      if (p) {
+         if (n) {
+            n->next = curworker->freenodes ;
+            curworker->freenodes = n ;
          }
-         return (leaf *)save((node *)p) ;
+         return save(p) ;
+      }
+      if (n == 0) {
+         n = newnode() ;
+         n->next = 0 ;
+         n->nw = nw ;
+         n->ne = ne ;
+         n->sw = sw ;
+         n->se = se ;
+         n->res = 0 ;
+         continue ;
       }
-      pred = p ;
+      if (g_cas_slot(b->slot + i, (hslot)0, nodeslot(n)))
+         break ;
    }
-   p = newleaf() ;
-   p->nw = nw ;
-   p->ne = ne ;
-   p->sw = sw ;
-   p->se = se ;
-   leafres(p) ;
-   p->isnode = 0 ;
-   p->next = hashtab[h] ;
-   hashtab[h] = (node *)p ;
-   hashpop++ ;
-   if (hashpop > hashlimit)
-      resize() ;
-   return (leaf *)save((node *)p) ;
+   b->tag[i] = hashtag(m, hashshift) ;
+   addedone_par() ;
+   return save(n) ;
+}
+leaf *hlifealgo::find_leaf_par(unsigned short nw, unsigned short ne,
+                               unsigned short sw, unsigned short se) {
+   hlifeleafkey k = { nw, ne, sw, se } ;
+   g_uintptr_t m = HASHMULT * leaf_hash(nw, ne, sw, se) ;
+   hlifebucket *b, *ob ;
+   int i, oi ;
+   node *p ;
+   leaf *n = 0 ;
+   for (;;) {
+      p = hashprobe(hashtab, hashmask, hashshift, m, k, b, i) ;
+      if (p == 0 && oldtab)
+         p = hashprobe(oldtab, oldmask, oldshift, m, k, ob, oi) ;
+      if (p) {
+         if (n) {
+            n->next = curworker->freenodes ;
+            curworker->freenodes = (node *)n ;
+         }
+         return (leaf *)save(p) ;
+      }
+      if (n == 0) {
+         n = newleaf() ;
+         n->next = 0 ;
+         n->nw = nw ;
+         n->ne = ne ;
+         n->sw = sw ;
+         n->se = se ;
+         newleafres(n) ;
+         n->isnode = 0 ;
+         continue ;
+      }
+      if (g_cas_slot(b->slot + i, (hslot)0, nodeslot((node *)n)))
+         break ;
+   }
+   b->tag[i] = hashtag(m, hashshift) ;
+   addedone_par() ;
+   return (leaf *)save((node *)n) ;
+}
+void hlifealgo::addedone_par() {
+   curworker->hashed++ ;
+   if (oldtab && curworker->ismain)
+      migrate(2) ;
 }
 /*
  *   The following routine does the same, but first it checks to see if
@@ -277,8 +890,15 @@ leaf *hlifealgo::find_leaf(unsigned short nw, unsigned short ne,
  *   stack pointer and garbage collection stuff.
  */
 node *hlifealgo::getres(node *n, int depth) {
-   if (n->res)
+   if (n->res) {
+     if (gctrack) {
+       setgcword(n, gcword(n) | GCUSED) ;
+       if (gcphase == GCMARK)
+         gcshade(n->res) ;
+       return save(n->res) ;
+     }
      return n->res ;
+   }
    node *res = 0 ;
    /**
     *   This routine be the only place we assign to res.  We use
@@ -291,16 +911,17 @@ node *hlifealgo::getres(node *n, int depth) {
     *   calls here, one to prevent us going deeper, and another
     *   to prevent us from destroying the cache field.
     */
-   if (poller->poll())
+   if (parallel && !curworker->ismain ? poller->isInterrupted()
+                                      : poller->poll())
      return zeronode(depth-1) ;
-   int sp = gsp ;
+   int sp = stackpos() ;
    depth-- ;
    if (ngens >= depth) {
      if (is_node(n->nw)) {
        res = dorecurs(n->nw, n->ne, n->sw, n->se, depth) ;
      } else {
-       res = (node *)dorecurs_leaf((leaf *)n->nw, (leaf *)n->ne,
-                                   (leaf *)n->sw, (leaf *)n->se) ;
+       res = (node *)dorecurs_leaf((leaf *)(node *)n->nw, (leaf *)(node *)n->ne,
+                                   (leaf *)(node *)n->sw, (leaf *)(node *)n->se) ;
      }
    } else {
      if (halvesdone < 1000)
@@ -308,11 +929,11 @@ node *hlifealgo::getres(node *n, int depth) {
      if (is_node(n->nw)) {
        res = dorecurs_half(n->nw, n->ne, n->sw, n->se, depth) ;
      } else if (ngens == 0) {
-       res = (node *)dorecurs_leaf_quarter((leaf *)n->nw, (leaf *)n->ne,
-                                           (leaf *)n->sw, (leaf *)n->se) ;
+       res = (node *)dorecurs_leaf_quarter((leaf *)(node *)n->nw, (leaf *)(node *)n->ne,
+                                           (leaf *)(node *)n->sw, (leaf *)(node *)n->se) ;
      } else {
-       res = (node *)dorecurs_leaf_half((leaf *)n->nw, (leaf *)n->ne,
-                                        (leaf *)n->sw, (leaf *)n->se) ;
+       res = (node *)dorecurs_leaf_half((leaf *)(node *)n->nw, (leaf *)(node *)n->ne,
+                                        (leaf *)(node *)n->sw, (leaf *)(node *)n->se) ;
      }
    }
    pop(sp) ;
@@ -320,6 +941,10 @@ node *hlifealgo::getres(node *n, int depth) {
      res = zeronode(depth) ;
    else
      n->res = res ;
+   if (gctrack) { // an incremental gc may drop n->res while we hold it
+     setgcword(n, gcword(n) | GCUSED) ;
+     save(res) ;
+   }
    return res ;
 }
 /*
@@ -335,7 +960,9 @@ node *hlifealgo::getres(node *n, int depth) {
  *   then put these together into a new n/2-square.  Simple, eh?
  */
 node *hlifealgo::dorecurs(node *n, node *ne, node *t, node *e, int depth) {
-   int sp = gsp ;
+   if (parallel && depth >= PARALLEL_DEPTH)
+      return dorecurs_par(n, ne, t, e, depth, 0) ;
+   int sp = stackpos() ;
    node
    *t00 = getres(n, depth),
    *t01 = getres(find_node(n->ne, ne->nw, n->se, ne->sw), depth),
@@ -359,7 +986,9 @@ node *hlifealgo::dorecurs(node *n, node *ne, node *t, node *e, int depth) {
  */
 node *hlifealgo::dorecurs_half(node *n, node *ne, node *t,
                                node *e, int depth) {
-   int sp = gsp ;
+   if (parallel && depth >= PARALLEL_DEPTH)
+      return dorecurs_par(n, ne, t, e, depth, 1) ;
+   int sp = stackpos() ;
    node
    *t00 = getres(n, depth),
    *t01 = getres(find_node(n->ne, ne->nw, n->se, ne->sw), depth),
@@ -396,27 +1025,123 @@ node *hlifealgo::dorecurs_half(node *n, node *ne, node *t,
    pop(sp) ;
    return save(n) ;
 }
+/*
+ *   The multithreaded version of both of the above, used near the top
+ *   of the tree.  It's the same computation, but we build all nine
+ *   (and then all four) nodes first and let the pool fill in their
+ *   results in parallel.  Everything we build is saved on our stack,
+ *   and the intermediate results hang off their res fields, so it all
+ *   survives a gc.  If we were interrupted some res fields may still
+ *   be empty; we use zeros since nothing computed now gets cached.
+ */
+node *hlifealgo::dorecurs_par(node *n, node *ne, node *t, node *e,
+                              int depth, int half) {
+   int sp = stackpos() ;
+   node *q[9], *r[9] ;
+   int i ;
+   q[0] = save(n) ;
+   q[1] = find_node(n->ne, ne->nw, n->se, ne->sw) ;
+   q[2] = save(ne) ;
+   q[3] = find_node(n->sw, n->se, t->nw, t->ne) ;
+   q[4] = find_node(n->se, ne->sw, t->ne, e->nw) ;
+   q[5] = find_node(ne->sw, ne->se, e->nw, e->ne) ;
+   q[6] = save(t) ;
+   q[7] = find_node(t->ne, e->nw, t->se, e->sw) ;
+   q[8] = save(e) ;
+   pool->getres(q, 9, depth) ;
+   for (i=0; i<9; i++)
+      r[i] = q[i]->res ? q[i]->res : zeronode(depth-1) ;
+   if (half) {
+      n = find_node(find_node(r[0]->se, r[1]->sw, r[3]->ne, r[4]->nw),
+                    find_node(r[1]->se, r[2]->sw, r[4]->ne, r[5]->nw),
+                    find_node(r[3]->se, r[4]->sw, r[6]->ne, r[7]->nw),
+                    find_node(r[4]->se, r[5]->sw, r[7]->ne, r[8]->nw)) ;
+   } else {
+      q[0] = find_node(r[0], r[1], r[3], r[4]) ;
+      q[1] = find_node(r[1], r[2], r[4], r[5]) ;
+      q[2] = find_node(r[3], r[4], r[6], r[7]) ;
+      q[3] = find_node(r[4], r[5], r[7], r[8]) ;
+      pool->getres(q, 4, depth) ;
+      for (i=0; i<4; i++)
+         r[i] = q[i]->res ? q[i]->res : zeronode(depth-1) ;
+      n = find_node(r[0], r[1], r[2], r[3]) ;
+   }
+   pop(sp) ;
+   return save(n) ;
+}
 /*
  *   If the node is a 16-node, then the constituents are leaves, so we
  *   need a very similar but still somewhat different subroutine.  Since
  *   we do not (yet) garbage collect leaves, we don't need all that
  *   save/pop mumbo-jumbo.
+ *
+ *   When we can do the rule bit-parallel, it's quicker to run the
+ *   whole 16-square forward than to build and look up nine more leaves.
  */
+leaf *hlifealgo::leafstep(leaf *n, leaf *ne, leaf *t, leaf *e, int gens) {
+   unsigned int top, bot, r[8] ;
+   leaf *q[4] = { n, ne, t, e } ;
+   for (int i=0; i<4; i++) {
+      unpack8x8(q[i]->nw, q[i]->ne, q[i]->sw, q[i]->se, &top, &bot) ;
+      r[2*i] = top ;
+      r[2*i+1] = bot ;
+   }
+   // rows 0-3, 4-7, 8-11 and 12-15 of the 16-square
+   unsigned long long w[4] ;
+   for (int i=0; i<4; i++)
+      w[i] = (leafspread(r[(i&2)*2 + (i&1)]) << 8) |
+              leafspread(r[(i&2)*2 + (i&1) + 2]) ;
+#ifdef HLIFEAVX2
+   __m256i x = _mm256_set_epi64x(w[3], w[2], w[1], w[0]) ;
+   // put row i in the i'th 16-bit field by reversing each word's four
+   x = _mm256_shufflehi_epi16(_mm256_shufflelo_epi16(x, 0x1b), 0x1b) ;
+   for (int g=0; g<gens; g++) {
+      __m256i wx = _mm256_srli_epi16(x, 1), ex = _mm256_slli_epi16(x, 1) ;
+      __m256i tl = wx ^ x ^ ex, th = (wx & x) | ((wx ^ x) & ex) ;
+      x = totalisticnext(x, leafnorth16(tl), leafnorth16(th), leafsouth16(tl),
+                   leafsouth16(th), wx ^ ex, wx & ex, leafbirth, leafsurvive) ;
+   }
+   x = _mm256_shufflehi_epi16(_mm256_shufflelo_epi16(x, 0x1b), 0x1b) ;
+   w[1] = _mm256_extract_epi64(x, 1) ;
+   w[2] = _mm256_extract_epi64(x, 2) ;
+#else
+   for (int g=0; g<gens; g++) {
+      unsigned long long tl[4], th[4], wx[4], ex[4] ;
+      for (int i=0; i<4; i++) {
+         wx[i] = w[i] >> 1 ;
+         ex[i] = w[i] << 1 ;
+         tl[i] = wx[i] ^ w[i] ^ ex[i] ;
+         th[i] = (wx[i] & w[i]) | ((wx[i] ^ w[i]) & ex[i]) ;
+      }
+      for (int i=0; i<4; i++)
+         w[i] = totalisticnext(w[i],
+                   (tl[i] >> 16) | (i > 0 ? tl[i-1] << 48 : 0),
+                   (th[i] >> 16) | (i > 0 ? th[i-1] << 48 : 0),
+                   (tl[i] << 16) | (i < 3 ? tl[i+1] >> 48 : 0),
+                   (th[i] << 16) | (i < 3 ? th[i+1] >> 48 : 0),
+                   wx[i] ^ ex[i], wx[i] & ex[i], leafbirth, leafsurvive) ;
+   }
+#endif
+   return find_leaf(leafquad16(w[1], 8), leafquad16(w[1], 4),
+                    leafquad16(w[2], 8), leafquad16(w[2], 4)) ;
+}
 leaf *hlifealgo::dorecurs_leaf(leaf *n, leaf *ne, leaf *t, leaf *e) {
+   if (leafbirth >= 0)
+      return leafstep(n, ne, t, e, 4) ;
    unsigned short
-   t00 = n->res2,
-   t01 = find_leaf(n->ne, ne->nw, n->se, ne->sw)->res2,
-   t02 = ne->res2,
-   t10 = find_leaf(n->sw, n->se, t->nw, t->ne)->res2,
-   t11 = find_leaf(n->se, ne->sw, t->ne, e->nw)->res2,
-   t12 = find_leaf(ne->sw, ne->se, e->nw, e->ne)->res2,
-   t20 = t->res2,
-   t21 = find_leaf(t->ne, e->nw, t->se, e->sw)->res2,
-   t22 = e->res2 ;
-   return find_leaf(find_leaf(t00, t01, t10, t11)->res2,
-                    find_leaf(t01, t02, t11, t12)->res2,
-                    find_leaf(t10, t11, t20, t21)->res2,
-                    find_leaf(t11, t12, t21, t22)->res2) ;
+   t00 = leafres2(n),
+   t01 = leafres2(find_leaf(n->ne, ne->nw, n->se, ne->sw)),
+   t02 = leafres2(ne),
+   t10 = leafres2(find_leaf(n->sw, n->se, t->nw, t->ne)),
+   t11 = leafres2(find_leaf(n->se, ne->sw, t->ne, e->nw)),
+   t12 = leafres2(find_leaf(ne->sw, ne->se, e->nw, e->ne)),
+   t20 = leafres2(t),
+   t21 = leafres2(find_leaf(t->ne, e->nw, t->se, e->sw)),
+   t22 = leafres2(e) ;
+   return find_leaf(leafres2(find_leaf(t00, t01, t10, t11)),
+                    leafres2(find_leaf(t01, t02, t11, t12)),
+                    leafres2(find_leaf(t10, t11, t20, t21)),
+                    leafres2(find_leaf(t11, t12, t21, t22))) ;
 }
 /*
  *   Same as above but we only do two generations.
@@ -424,16 +1149,18 @@ leaf *hlifealgo::dorecurs_leaf(leaf *n, leaf *ne, leaf *t, leaf *e) {
 #define combine4(t00,t01,t10,t11) (unsigned short)\
 ((((t00)<<10)&0xcc00)|(((t01)<<6)&0x3300)|(((t10)>>6)&0xcc)|(((t11)>>10)&0x33))
 leaf *hlifealgo::dorecurs_leaf_half(leaf *n, leaf *ne, leaf *t, leaf *e) {
+   if (leafbirth >= 0)
+      return leafstep(n, ne, t, e, 2) ;
    unsigned short
-   t00 = n->res2,
-   t01 = find_leaf(n->ne, ne->nw, n->se, ne->sw)->res2,
-   t02 = ne->res2,
-   t10 = find_leaf(n->sw, n->se, t->nw, t->ne)->res2,
-   t11 = find_leaf(n->se, ne->sw, t->ne, e->nw)->res2,
-   t12 = find_leaf(ne->sw, ne->se, e->nw, e->ne)->res2,
-   t20 = t->res2,
-   t21 = find_leaf(t->ne, e->nw, t->se, e->sw)->res2,
-   t22 = e->res2 ;
+   t00 = leafres2(n),
+   t01 = leafres2(find_leaf(n->ne, ne->nw, n->se, ne->sw)),
+   t02 = leafres2(ne),
+   t10 = leafres2(find_leaf(n->sw, n->se, t->nw, t->ne)),
+   t11 = leafres2(find_leaf(n->se, ne->sw, t->ne, e->nw)),
+   t12 = leafres2(find_leaf(ne->sw, ne->se, e->nw, e->ne)),
+   t20 = leafres2(t),
+   t21 = leafres2(find_leaf(t->ne, e->nw, t->se, e->sw)),
+   t22 = leafres2(e) ;
    return find_leaf(combine4(t00, t01, t10, t11),
                     combine4(t01, t02, t11, t12),
                     combine4(t10, t11, t20, t21),
@@ -444,49 +1171,259 @@ leaf *hlifealgo::dorecurs_leaf_half(leaf *n, leaf *ne, leaf *t, leaf *e) {
  */
 leaf *hlifealgo::dorecurs_leaf_quarter(leaf *n, leaf *ne,
                                    leaf *t, leaf *e) {
+   if (leafbirth >= 0)
+      return leafstep(n, ne, t, e, 1) ;
    unsigned short
-   t00 = n->res1,
-   t01 = find_leaf(n->ne, ne->nw, n->se, ne->sw)->res1,
-   t02 = ne->res1,
-   t10 = find_leaf(n->sw, n->se, t->nw, t->ne)->res1,
-   t11 = find_leaf(n->se, ne->sw, t->ne, e->nw)->res1,
-   t12 = find_leaf(ne->sw, ne->se, e->nw, e->ne)->res1,
-   t20 = t->res1,
-   t21 = find_leaf(t->ne, e->nw, t->se, e->sw)->res1,
-   t22 = e->res1 ;
+   t00 = leafres1(n),
+   t01 = leafres1(find_leaf(n->ne, ne->nw, n->se, ne->sw)),
+   t02 = leafres1(ne),
+   t10 = leafres1(find_leaf(n->sw, n->se, t->nw, t->ne)),
+   t11 = leafres1(find_leaf(n->se, ne->sw, t->ne, e->nw)),
+   t12 = leafres1(find_leaf(ne->sw, ne->se, e->nw, e->ne)),
+   t20 = leafres1(t),
+   t21 = leafres1(find_leaf(t->ne, e->nw, t->se, e->sw)),
+   t22 = leafres1(e) ;
    return find_leaf(combine4(t00, t01, t10, t11),
                     combine4(t01, t02, t11, t12),
                     combine4(t10, t11, t20, t21),
                     combine4(t11, t12, t21, t22)) ;
 }
+/*
+ *   The node blocks can live in a spill file rather than on the heap.
+ *   The file is mapped shared, so the system writes cold pages back to
+ *   it and reads them in again when they're touched, and the hash
+ *   (which is what we touch most) stays in memory.  We unlink the file
+ *   as soon as it's made, map it SPILLCHUNK bytes at a time, and carve
+ *   blocks out of each chunk; like heap blocks, they are only given
+ *   back when the universe goes away.  Chunks are aligned on a megabyte
+ *   so the compact build can use them for slabs.
+ */
+#define SPILLCHUNK ((g_uintptr_t)64 << 20)
+#define SPILLALIGN ((g_uintptr_t)1 << 20)
+struct hlifespill {
+   int fd ;
+   g_uintptr_t size, limit ; // bytes of the file in use, and the most
+   char *cur ;               // where the next block comes from
+   g_uintptr_t left ;        // and how much of the chunk remains
+   vector<char *> chunks ;
+} ;
+#ifndef _WIN32
+/*
+ *   Get a cleared block from the spill file, or zero if the disk is
+ *   full (in which case we'll stop using it).
+ */
+static void *spillget(hlifespill *s, g_uintptr_t bytes) {
+   bytes = (bytes + 63) & ~(g_uintptr_t)63 ;
+   if (s->left < bytes) {
+      if (s->size + SPILLCHUNK > s->limit)
+         return 0 ;
+#ifdef __linux__
+      if (posix_fallocate(s->fd, s->size, SPILLCHUNK) != 0) {
+#else
+      if (ftruncate(s->fd, s->size + SPILLCHUNK) != 0) {
+#endif
+         s->limit = s->size ;
+         return 0 ;
+      }
+      // reserve enough address space to align the chunk, then map it
+      char *r = (char *)mmap(0, SPILLCHUNK + SPILLALIGN, PROT_NONE,
+                             MAP_PRIVATE | MAP_ANON, -1, 0) ;
+      if (r == (char *)MAP_FAILED)
+         return 0 ;
+      char *a = (char *)(((g_uintptr_t)r + SPILLALIGN - 1) &
+                         ~(SPILLALIGN - 1)) ;
+      if (mmap(a, SPILLCHUNK, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_FIXED,
+               s->fd, s->size) == MAP_FAILED) {
+         munmap(r, SPILLCHUNK + SPILLALIGN) ;
+         return 0 ;
+      }
+      if (a > r)
+         munmap(r, a - r) ;
+      if (a + SPILLCHUNK < r + SPILLCHUNK + SPILLALIGN)
+         munmap(a + SPILLCHUNK, r + SPILLALIGN - a) ;
+      s->chunks.push_back(a) ;
+      s->size += SPILLCHUNK ;
+      s->cur = a ;
+      s->left = SPILLCHUNK ;
+   }
+   void *r = s->cur ;
+   s->cur += bytes ;
+   s->left -= bytes ;
+   return r ;
+}
+static int spillowns(hlifespill *s, void *p) {
+   for (size_t i=0; i<s->chunks.size(); i++)
+      if ((char *)p >= s->chunks[i] && (char *)p < s->chunks[i] + SPILLCHUNK)
+         return 1 ;
+   return 0 ;
+}
+static void spillclose(hlifespill *s) {
+   for (size_t i=0; i<s->chunks.size(); i++)
+      munmap(s->chunks[i], SPILLCHUNK) ;
+   close(s->fd) ;
+   delete s ;
+}
+#else
+static void *spillget(hlifespill *, g_uintptr_t) { return 0 ; }
+static int spillowns(hlifespill *, void *) { return 0 ; }
+static void spillclose(hlifespill *s) { delete s ; }
+#endif
+/*
+ *   Start spilling to a new file in dir.  We use up to most of the
+ *   space that's free on that disk now.
+ */
+const char *hlifealgo::setSpillDir(const char *dir) {
+   if (dir == 0 || *dir == 0)
+      return 0 ;
+   if (spill)
+      return "The spill directory can only be set once." ;
+#ifdef _WIN32
+   return "Spilling to disk is not supported on this platform." ;
+#else
+   string name = string(dir) + "/hlifeXXXXXX" ;
+   vector<char> buf(name.begin(), name.end()) ;
+   buf.push_back(0) ;
+   int fd = mkstemp(&buf[0]) ;
+   if (fd < 0)
+      return "Could not create a spill file in the spill directory." ;
+   unlink(&buf[0]) ;
+   struct statvfs st ;
+   if (fstatvfs(fd, &st) != 0) {
+      close(fd) ;
+      return "Could not find the free space in the spill directory." ;
+   }
+   spill = new hlifespill ;
+   spill->fd = fd ;
+   spill->size = 0 ;
+   spill->limit = (g_uintptr_t)st.f_bavail * st.f_frsize ;
+   spill->limit -= spill->limit / 16 ;
+   spill->cur = 0 ;
+   spill->left = 0 ;
+   return 0 ;
+#endif
+}
+/*
+ *   How much memory we'd be using with this many more nodes, to compare
+ *   against maxmem.  Normally that's just what we've allocated.  With a
+ *   spill file, the nodes don't count; instead we're full when either
+ *   the file is, or the hash can't double again and is 7/8 full.
+ */
+g_uintptr_t hlifealgo::memused(g_uintptr_t morenodes) {
+   if (spill == 0)
+      return alloced + morenodes * sizeof(node) ;
+   double full = (double)(spill->size - spill->left +
+                          morenodes * sizeof(node)) / (spill->limit + 1) ;
+   g_uintptr_t nbytes = (2 * (hashmask + 1) + 1) * sizeof(hlifebucket) ;
+   if (alloced + nbytes > maxmem) {
+      double hfull = (double)(totalthings + morenodes) /
+                     (7 * (HBSLOTS * (hashmask + 1) / 8)) ;
+      if (hfull > full)
+         full = hfull ;
+   }
+   g_uintptr_t used = (g_uintptr_t)(full * maxmem) ;
+   return (used > alloced ? used : alloced) ;
+}
 /*
  *   We keep free nodes in a linked list for allocation, and we allocate
- *   them 1000 at a time.
+ *   them NODESPERBLOCK at a time; the first node of each block links the
+ *   blocks together.  In the compact build a block is a whole slab.
  */
+#ifdef HLIFECOMPACT
+char *hlifeslabs[HSLABMAX] ;
+static std::mutex slablock ;
+static node *allocslab(hlifespill *spill, int &inram) {
+   std::unique_lock<std::mutex> lk(slablock) ;
+   int i ;
+   for (i=1; i<HSLABMAX; i++)
+      if (hlifeslabs[i] == 0)
+         break ;
+   if (i >= HSLABMAX)
+      return 0 ;
+   void *mem = 0 ;
+   inram = 0 ;
+   if (spill)
+      mem = spillget(spill, 1 << HSLABBITS) ;
+   if (mem == 0) {
+      inram = 1 ;
+#ifdef _WIN32
+      mem = _aligned_malloc(1 << HSLABBITS, 1 << HSLABBITS) ;
+#else
+      if (posix_memalign(&mem, 1 << HSLABBITS, 1 << HSLABBITS) != 0)
+         mem = 0 ;
+#endif
+      if (mem == 0)
+         return 0 ;
+      memset(mem, 0, 1 << HSLABBITS) ;
+   }
+   ((unsigned int *)mem)[1] = i ;
+   hlifeslabs[i] = (char *)mem ;
+   return (node *)mem ;
+}
+static void freeslab(node *p, int inram) {
+   std::unique_lock<std::mutex> lk(slablock) ;
+   hlifeslabs[((unsigned int *)p)[1]] = 0 ;
+   if (!inram)
+      return ;
+#ifdef _WIN32
+   _aligned_free(p) ;
+#else
+   free(p) ;
+#endif
+}
+#endif
+void hlifealgo::allocblock() {
+   int i, inram = 1 ;
+#ifndef HLIFECOMPACT
+   freenodes = 0 ;
+   if (spill) {
+      freenodes = (node *)spillget(spill, (NODESPERBLOCK + 1) * sizeof(node)) ;
+      inram = (freenodes == 0) ;
+   }
+   if (freenodes == 0)
+      freenodes = (node *)calloc(NODESPERBLOCK + 1, sizeof(node)) ;
+#else
+   freenodes = allocslab(spill, inram) ;
+#endif
+   if (freenodes == 0)
+      lifefatal("Out of memory; try reducing the hash memory limit.") ;
+   if (inram)
+      alloced += (NODESPERBLOCK + 1) * sizeof(node) ;
+   freenodes->next = nodeblocks ;
+   nodeblocks = freenodes++ ;
+   for (i=0; i<NODESPERBLOCK-1; i++) {
+      freenodes[1].next = freenodes ;
+      freenodes++ ;
+   }
+   totalthings += NODESPERBLOCK ;
+}
 node *hlifealgo::newnode() {
    node *r ;
-   if (freenodes == 0) {
-      int i ;
-      freenodes = (node *)calloc(1001, sizeof(node)) ;
-      if (freenodes == 0)
-         lifefatal("Out of memory; try reducing the hash memory limit.") ;
-      alloced += 1001 * sizeof(node) ;
-      freenodes->next = nodeblocks ;
-      nodeblocks = freenodes++ ;
-      for (i=0; i<999; i++) {
-         freenodes[1].next = freenodes ;
-         freenodes++ ;
-      }
-      totalthings += 1000 ;
-   }
-   if (freenodes->next == 0 && alloced + 1000 * sizeof(node) > maxmem &&
-       okaytogc) {
-      do_gc(0) ;
+   if (parallel)
+      return newnode_par() ;
+   if (freenodes == 0)
+      allocblock() ;
+   if (freenodes->next == 0 && okaytogc) {
+      if (gcincremental)
+         gcroom() ;
+      else if (memused(NODESPERBLOCK) > maxmem)
+         do_gc(0) ;
    }
    r = freenodes ;
    freenodes = freenodes->next ;
    return r ;
 }
+/*
+ *   When running multithreaded we allocate from our private chunk of
+ *   the free list.  This is also where workers stop for a sync.
+ */
+node *hlifealgo::newnode_par() {
+   hlifeworker *w = curworker ;
+   if (w->freenodes == 0 || pool->syncwanted)
+      pool->refill() ;
+   node *r = w->freenodes ;
+   w->freenodes = r->next ;
+   return r ;
+}
 /*
  *   Leaves are the same.
  */
@@ -503,6 +1440,65 @@ node *hlifealgo::newclearednode() {
 leaf *hlifealgo::newclearedleaf() {
    return (leaf *)memset(newleaf(), 0, sizeof(leaf)) ;
 }
+/*
+ *   Bounded grids.  For a torus (or a tube, which only wraps one way)
+ *   and for a bounded plane we do the wrapping or the clipping in the
+ *   tree ourselves, so we can take steps of any size rather than have
+ *   the caller copy the edges around a generation at a time.  Other
+ *   topologies, and B0 rules (whose background flips), still go through
+ *   CreateBorderCells() and DeleteBorderCells().
+ *
+ *   A torus is an endless pattern that repeats, so to step it we build
+ *   a node holding the grid plus a margin as wide as the step, filled
+ *   with copies of the grid (tilenode()), run that the usual way, and
+ *   cut the grid back out of the middle (clipnode()).  When the sides
+ *   are powers of two the copies line up with the tree, and the tiled
+ *   node is only a few new nodes however big the step.  When they are
+ *   not, the copies land everywhere and a big step would need a great
+ *   many of them, so we run at most cap doublings at once and do bigger
+ *   steps by stepping repeatedly; a torus usually settles into a cycle,
+ *   so we remember each of those results by the node it started from
+ *   (in steps) and still jump ahead quickly.
+ *
+ *   On a bounded plane the cells outside the grid are cleared every
+ *   generation, so the result of a node depends on where it is.  Nodes
+ *   wholly inside the grid use the usual results; for those that cross
+ *   an edge we do the same recursion with positions (boundres()), keep
+ *   those results in a table of our own, and at the bottom run the
+ *   16-squares a generation at a time (boundleaf()).
+ *
+ *   Coordinates here are long longs, with the root centered on the
+ *   origin as usual; BOUNDMAXDEPTH keeps them in range.  Everything in
+ *   the tables is also on the stack, so it survives a gc, and the
+ *   tables are emptied whenever the stack is popped past them.
+ */
+#define BOUNDMAXDEPTH (56)
+struct hlifeboundkey {
+   node *n ;
+   int depth ;
+   long long x, y ;
+   bool operator==(const hlifeboundkey &k) const {
+      return n == k.n && depth == k.depth && x == k.x && y == k.y ;
+   }
+} ;
+struct hlifeboundhash {
+   size_t operator()(const hlifeboundkey &k) const {
+      return (size_t)(5 * (g_uintptr_t)k.n + 17 * (g_uintptr_t)k.depth +
+                      257 * (g_uintptr_t)k.x + 65537 * (g_uintptr_t)k.y) ;
+   }
+} ;
+typedef unordered_map<hlifeboundkey, node *, hlifeboundhash> hlifeboundmap ;
+struct hlifebound {
+   int plane ;                          // bounded plane rather than torus
+   long long left, top, right, bottom ; // the grid, inclusive
+   long long wd, ht ;                   // or zero if unbounded that way
+   int cap ;                            // most doublings we run at once
+   node *rootnode ;                     // the pattern tilenode() copies
+   int rootdepth ;
+   leaf *last ;                         // the leaf leafat() found last
+   long long lastx, lasty ;
+   hlifeboundmap res, tiles, steps ;
+} ;
 hlifealgo::hlifealgo() {
    int i ;
 /*
@@ -514,27 +1510,37 @@ hlifealgo::hlifealgo() {
    if (shortpop[1] == 0)
       for (i=1; i<65536; i++)
          shortpop[i] = shortpop[i & (i - 1)] + 1 ;
-   hashprime = nextprime(1000) ;
-   hashlimit = hashprime ;
+   hashmask = 127 ;
+   hashshift = HASHBITS - 7 ;
+   hashlimit = 3 * HBSLOTS * (hashmask + 1) / 4 ;
    hashpop = 0 ;
-   hashtab = (node **)calloc(hashprime, sizeof(node *)) ;
+   hashtab = allocbuckets(hashmask + 1, hashmem) ;
    if (hashtab == 0)
      lifefatal("Out of memory (1).") ;
-   alloced += hashprime * sizeof(node *) ;
+   alloced = (hashmask + 2) * sizeof(hlifebucket) ;
+   oldtab = 0 ;
+   oldmem = 0 ;
+   hashslack = 0 ;
    ngens = 0 ;
    stacksize = 0 ;
    halvesdone = 0 ;
    nzeros = 0 ;
    stack = 0 ;
    gsp = 0 ;
-   alloced = 0 ;
    maxmem = 256 * 1024 * 1024 ;
    freenodes = 0 ;
    okaytogc = 0 ;
    totalthings = 0 ;
    nodeblocks = 0 ;
    zeronodea = 0 ;
-   ruletable = hliferules.rule0 ;
+   pool = 0 ;
+   parallel = 0 ;
+   spill = 0 ;
+   bound = 0 ;
+   boundextra = 0 ;
+   ruletable = ruletable2 = hliferules.rule0 ;
+   ruleparity = 0 ;
+   setleafrule() ;
 /*
  *   We initialize our universe to be a 16-square.  We are in drawing
  *   mode at this point.
@@ -555,17 +1561,41 @@ hlifealgo::hlifealgo() {
    cacheinvalid = 0 ;
    gccount = 0 ;
    gcstep = 0 ;
+   gcmaxpause = 0 ;
+   gcincremental = 0 ;
+   stepcaches = 0 ;
+   rulecaches = 0 ;
+   keptbytes = 0 ;
+   gctrack = 0 ;
+   gcphase = GCIDLE ;
+   gcepoch = 0 ;
+   gccursor = 0 ;
+   gcpace = 1 ;
+   gcfreed = 0 ;
 }
 /**
  *   Destructor frees memory.
  */
 hlifealgo::~hlifealgo() {
-   free(hashtab) ;
+   if (pool)
+      stopthreads() ;
+   free(hashmem) ;
+   if (oldmem)
+      free(oldmem) ;
    while (nodeblocks) {
       node *r = nodeblocks ;
       nodeblocks = nodeblocks->next ;
-      free(r) ;
+      int inram = (spill == 0 || !spillowns(spill, r)) ;
+#ifndef HLIFECOMPACT
+      if (inram)
+         free(r) ;
+#else
+      freeslab(r, inram) ;
+#endif
    }
+   if (spill)
+      spillclose(spill) ;
+   delete bound ;
    if (zeronodea)
       free(zeronodea) ;
    if (stack)
@@ -601,6 +1631,11 @@ void hlifealgo::step() {
       nonpow2 = t.low31() ;
       if (t != nonpow2)
          lifefatal("bad increment") ;
+      int extra = 0 ;
+      if (bound && newpow2 > bound->cap) {
+         extra = newpow2 - bound->cap ;
+         newpow2 = bound->cap ;
+      }
       int downto = newpow2 ;
       if (ngens < newpow2)
          downto = ngens ;
@@ -611,13 +1646,18 @@ void hlifealgo::step() {
          ngens = newpow2 ;
       }
       setincrement = pendingincrement ;
+      boundextra = extra ;
       pow2step = 1 ;
       while (newpow2--)
          pow2step += pow2step ;
+      while (extra--)
+         pow2step += pow2step ;
    }
    gcstep = 0 ;
    for (int i=0; i<nonpow2; i++) {
-      node *newroot = runpattern() ;
+      if (hliferules.alternate_rules && generation.odd() != ruleparity)
+         setruleparity(generation.odd()) ;
+      node *newroot = bound ? boundedstep() : runpattern() ;
       if (newroot == 0 || poller->isInterrupted()) // we *were* interrupted
          break ;
       popValid = 0 ;
@@ -648,13 +1688,81 @@ void hlifealgo::setMaxMemory(int newmemlimit) {
       return ;
    }
    maxmem = newlimit ;
-   hashlimit = hashprime ;
+   hashlimit = 3 * HBSLOTS * (hashmask + 1) / 4 ;
 }
-/**
- *   Clear everything.
+/*
+ *   Set the number of threads.  The workers are started lazily by
+ *   the first step that can use them.
  */
-void hlifealgo::clearall() {
-   lifefatal("clearall not implemented yet") ;
+void hlifealgo::setThreads(int n) {
+   poller->bailIfCalculating() ;
+   lifealgo::setThreads(n) ;
+   if (pool && (int)pool->workers.size() != numthreads)
+      stopthreads() ;
+}
+void hlifealgo::startthreads() {
+   pool = new hlifepool(this, numthreads) ;
+   for (int i=1; i<numthreads; i++)
+      pool->threads.push_back(std::thread(&hlifepool::workermain, pool, i)) ;
+}
+void hlifealgo::stopthreads() {
+   {
+      std::unique_lock<std::mutex> lk(pool->lock) ;
+      pool->quit = 1 ;
+      pool->wake.notify_all() ;
+   }
+   for (size_t i=0; i<pool->threads.size(); i++)
+      pool->threads[i].join() ;
+   for (size_t i=0; i<pool->workers.size(); i++) {
+      alloced -= sizeof(node *) * pool->workers[i].stacksize ;
+      free(pool->workers[i].stack) ;
+   }
+   delete pool ;
+   pool = 0 ;
+}
+/*
+ *   Enter and leave multithreaded mode.  On the way out we give back
+ *   everyone's unused free list chunks and settle the hash count.
+ */
+void hlifealgo::beginparallel() {
+   // each thread may add up to a chunk of nodes before hashpop hears
+   // about it, and the table must never overflow
+   hashslack = pool->workers.size() * FREECHUNK ;
+   while (hashpop + hashslack > hashlimit)
+      resize() ;
+   gcabort() ; // the workers use stop-the-world gcs
+   gctrack = 0 ;
+   curworker = &pool->workers[0] ;
+   parallel = 1 ;
+}
+void hlifealgo::endparallel() {
+   std::unique_lock<std::mutex> lk(pool->lock) ;
+   parallel = 0 ;
+   curworker = 0 ;
+   gctrack = gcincremental ;
+   for (size_t i=0; i<pool->workers.size(); i++) {
+      hlifeworker &w = pool->workers[i] ;
+      hashpop += w.hashed ;
+      w.hashed = 0 ;
+      w.gsp = 0 ;
+      while (w.freenodes) {
+         node *p = w.freenodes ;
+         w.freenodes = p->next ;
+         p->next = freenodes ;
+         freenodes = p ;
+      }
+   }
+   hashslack = 0 ;
+   if (oldtab && oldcursor > oldmask)
+      finishresize() ;
+   if (hashpop > hashlimit)
+      resize() ;
+}
+/**
+ *   Clear everything.
+ */
+void hlifealgo::clearall() {
+   lifefatal("clearall not implemented yet") ;
 }
 /*
  *   This routine expands our universe by a factor of two, maintaining
@@ -801,7 +1909,7 @@ node *hlifealgo::setbit(node *n, int x, int y, int newstate, int depth) {
          wh = 1 << (depth - 1) ;
       }
       depth-- ;
-      node **nptr ;
+      nodefield *nptr ;
       if (x < 0) {
          if (y < 0)
             nptr = &(n->sw) ;
@@ -1114,19 +2222,42 @@ node *hlifealgo::popzeros(node *n) {
  *   A lot of the routines from here on down traverse the universe, hanging
  *   information off the nodes.  The way they generally do so is by using
  *   (or abusing) the cache (res) field, and the least significant bit of
- *   the hash next field (as a visited bit).
+ *   the next field (as a visited bit).  The rest of the next field of
+ *   a node in the hash only matters to an incremental gc, which is
+ *   abandoned (or finished) before any of these run.
  */
+#ifndef HLIFECOMPACT
 #define marked(n) (1 & (g_uintptr_t)(n)->next)
 #define mark(n) ((n)->next = (node *)(1 | (g_uintptr_t)(n)->next))
 #define clearmark(n) ((n)->next = (node *)(~1 & (g_uintptr_t)(n)->next))
-#define clearmarkbit(p) ((node *)(~1 & (g_uintptr_t)(p)))
+#else
+#define marked(n) (1 & (n)->next.i)
+#define mark(n) ((n)->next.i |= 1)
+#define clearmark(n) ((n)->next.i &= ~1)
+#endif
 /*
  *   Sometimes we want to use *res* instead of next to mark.  You cannot
  *   do this to leaves, though.
  */
+#ifndef HLIFECOMPACT
 #define marked2(n) (1 & (g_uintptr_t)(n)->res)
 #define mark2(n) ((n)->res = (node *)(1 | (g_uintptr_t)(n)->res))
 #define clearmark2(n) ((n)->res = (node *)(~1 & (g_uintptr_t)(n)->res))
+#else
+#define marked2(n) (1 & (n)->res.i)
+#define mark2(n) ((n)->res.i |= 1)
+#define clearmark2(n) ((n)->res.i &= ~1)
+#endif
+/*
+ *   And sometimes we hang a number (not a pointer) off a field.
+ */
+#ifndef HLIFECOMPACT
+#define scratch(f) ((g_uintptr_t)(f))
+#define setscratch(f, v) ((f) = (node *)(v))
+#else
+#define scratch(f) ((g_uintptr_t)(f).i)
+#define setscratch(f, v) ((f).i = (unsigned int)(v))
+#endif
 static void sum4(bigint &dest, const bigint &a, const bigint &b,
                  const bigint &c, const bigint &d) {
    dest = a ;
@@ -1134,58 +2265,95 @@ static void sum4(bigint &dest, const bigint &a, const bigint &b,
    dest += c ;
    dest += d ;
 }
+/*
+ *   The population of a node of depth POPSMALLDEPTH or less fits in a
+ *   G_INT64, so we only use bigints above that.  Most of the tree
+ *   usually survives from one generation to the next, so we also keep
+ *   the populations of nodes of depth POPMEMODEPTH or more between
+ *   calls, in popmemo.  That is a table of 2**POPMEMOBITS entries
+ *   indexed by a hash of the node, where a new entry simply replaces
+ *   whatever was there; a gc that frees anything (and so may reuse a
+ *   node for something else) empties it.
+ */
+#define POPSMALLDEPTH (30)
+#define POPMEMODEPTH (5)
+#define POPMEMOBITS (16)
+struct hlifepopmemo {
+   node *n ;
+   G_INT64 pop ;
+} ;
+static inline g_uintptr_t popmemoslot(node *n) {
+   return (HASHMULT * (g_uintptr_t)n) >>
+          (8 * sizeof(g_uintptr_t) - POPMEMOBITS) ;
+}
 /*
  *   This recursive routine calculates the population by hanging the
- *   population on marked nodes.
+ *   population on marked nodes; the values live in popcache (for the
+ *   big nodes) and in popsmall, indexed by the next field.
  */
 const bigint &hlifealgo::calcpop(node *root, int depth) {
    if (root == zeronode(depth))
       return bigint::zero ;
-   if (depth == 2) {
-      root->nw = 0 ;
-      bigint &r = *(bigint *)&(root->nw) ;
-      leaf *n = (leaf *)root ;
-      r = n->leafpop ;
-      return r ;
+   if (depth <= POPSMALLDEPTH) {
+      popcache.push_back(bigint(smallpop(root, depth))) ;
+      return popcache.back() ;
    } else if (marked2(root)) {
-      return *(bigint*)&(root->next) ;
+      return popcache[scratch(root->next)] ;
    } else {
       depth-- ;
-      unhash_node(root) ;
-/**
- *   We use the memory in root->next as a value bigint.  But we want to
- *   make sure the copy constructor doesn't "clean up" something that
- *   doesn't exist.  So we clear it to zero here.
- */
-      root->next = (node *)0 ; // I wish I could come up with a cleaner way
-      sum4(*(bigint *)&(root->next),
-           calcpop(root->nw, depth), calcpop(root->ne, depth),
+      setscratch(root->next, popcache.size()) ;
+      popcache.push_back(bigint::zero) ;
+      bigint &r = popcache.back() ;
+      sum4(r, calcpop(root->nw, depth), calcpop(root->ne, depth),
            calcpop(root->sw, depth), calcpop(root->se, depth)) ;
       mark2(root) ;
-      return *(bigint *)&(root->next) ;
+      return r ;
+   }
+}
+G_INT64 hlifealgo::smallpop(node *root, int depth) {
+   if (root == zeronode(depth))
+      return 0 ;
+   if (depth == 2)
+      return leafpopof((leaf *)root) ;
+   if (marked2(root))
+      return popsmall[scratch(root->next)] ;
+   hlifepopmemo *m = 0 ;
+   if (depth >= POPMEMODEPTH) {
+      m = &popmemo[popmemoslot(root)] ;
+      if (m->n == root)
+         return m->pop ;
+   }
+   int d = depth - 1 ;
+   G_INT64 r = smallpop(root->nw, d) + smallpop(root->ne, d) +
+               smallpop(root->sw, d) + smallpop(root->se, d) ;
+   if (m) {
+      m->n = root ;
+      m->pop = r ;
    }
+   setscratch(root->next, popsmall.size()) ;
+   popsmall.push_back(r) ;
+   mark2(root) ;
+   return r ;
 }
 /*
- *   Call this after doing something that unhashes nodes in order to
- *   use the next field as a temp pointer.
+ *   Call this after doing something that uses the next field of nodes
+ *   as a temp pointer, to clear it again.
  */
-void hlifealgo::aftercalcpop2(node *root, int depth, int cleanbigints) {
+void hlifealgo::aftercalcpop2(node *root, int depth) {
    if (root == zeronode(depth))
       return ;
    if (depth == 2) {
-      root->nw = 0 ; // all these bigints are guaranteed to be small
+      root->nw = 0 ; // writecell_2p1() numbers leaves here
       return ;
    }
    if (marked2(root)) {
       clearmark2(root) ;
       depth-- ;
-      aftercalcpop2(root->nw, depth, cleanbigints) ;
-      aftercalcpop2(root->ne, depth, cleanbigints) ;
-      aftercalcpop2(root->sw, depth, cleanbigints) ;
-      aftercalcpop2(root->se, depth, cleanbigints) ;
-      if (cleanbigints)
-         *(bigint *)&(root->next) = bigint::zero ; // clean up; yuck!
-      rehash_node(root) ;
+      aftercalcpop2(root->nw, depth) ;
+      aftercalcpop2(root->ne, depth) ;
+      aftercalcpop2(root->sw, depth) ;
+      aftercalcpop2(root->se, depth) ;
+      root->next = 0 ;
    }
 }
 /*
@@ -1194,9 +2362,124 @@ void hlifealgo::aftercalcpop2(node *root, int depth, int cleanbigints) {
 void hlifealgo::calcPopulation(node *root) {
    int depth ;
    ensure_hashed() ;
+   gcabort() ;
    depth = node_depth(root) ;
+   if (popmemo.empty())
+      popmemo.resize((size_t)1 << POPMEMOBITS) ;
    population = calcpop(root, depth) ;
-   aftercalcpop2(root, depth, 1) ;
+   aftercalcpop2(root, depth) ;
+   popcache.clear() ;
+   popsmall.clear() ;
+}
+/*
+ *   The bounding box of the live cells of a node, as left, top, right
+ *   and bottom in cells from its upper left corner (rows counting
+ *   down, as in the tree), so the edges of the whole pattern come
+ *   straight from the root's.  Like populations, the edges of nodes
+ *   at least EDGEMEMODEPTH deep are kept between calls, in a table of
+ *   2**EDGEMEMOBITS entries indexed by a hash of the node, that a gc
+ *   which frees anything empties.  Offsets have to fit in a long long,
+ *   so nodeedges() returns 0 for a root deeper than EDGEMAXDEPTH and
+ *   findedges() and fit() go back to scanning the tree level by level.
+ */
+#define EDGEMAXDEPTH (61)
+#define EDGEMEMOBITS (12)
+#define EDGEMEMODEPTH (5)
+struct hlifeedgememo {
+   node *n ;
+   long long e[4] ;
+} ;
+static inline g_uintptr_t edgememoslot(node *n) {
+   return (HASHMULT * (g_uintptr_t)n) >>
+          (8 * sizeof(g_uintptr_t) - EDGEMEMOBITS) ;
+}
+/*
+ *   Rows and columns of a 4-square that have anything in them, the
+ *   first in the high bit.
+ */
+static inline int quadrows(unsigned short q) {
+   return ((q & 0xf000) ? 8 : 0) | ((q & 0x0f00) ? 4 : 0) |
+          ((q & 0x00f0) ? 2 : 0) | ((q & 0x000f) ? 1 : 0) ;
+}
+static inline int quadcols(unsigned short q) {
+   return (q | (q >> 4) | (q >> 8) | (q >> 12)) & 0xf ;
+}
+/*
+ *   The same distance as nodeedge() below, for a nonempty leaf.
+ */
+static int leafedge(leaf *l, int side) {
+   int bits, i ;
+   if (side & 1)
+      bits = (quadrows(l->nw | l->ne) << 4) | quadrows(l->sw | l->se) ;
+   else
+      bits = (quadcols(l->nw | l->sw) << 4) | quadcols(l->ne | l->se) ;
+   if (side < 2)
+      for (i=0; !(bits & (0x80 >> i)); i++) ;
+   else
+      for (i=0; !(bits & (1 << i)); i++) ;
+   return i ;
+}
+/*
+ *   How far in from one side of a nonempty node its nearest live cell
+ *   is:  side 0 is the left, 1 the top, 2 the right and 3 the bottom.
+ *   As in a scan of that side of the tree, we give up on children that
+ *   cannot come nearer than limit; then we just return something no
+ *   smaller than limit, and only exact answers go into the table.
+ */
+long long hlifealgo::nodeedge(node *root, int depth, int side,
+                            long long limit) {
+   hlifeedgememo *m = 0 ;
+   if (depth >= EDGEMEMODEPTH) {
+      m = &edgememo[edgememoslot(root)] ;
+      if (m->n == root && m->e[side] >= 0)
+         return m->e[side] ;
+   }
+   depth-- ;
+   long long h = 1LL << (depth + 1), r = limit ;
+   node *z = zeronode(depth) ;
+   node *c[4] = { root->nw, root->ne, root->sw, root->se } ;
+   // the two children on that side first, then the two behind them
+   static const int order[4][4] = { { 0, 2, 1, 3 }, { 0, 1, 2, 3 },
+                                    { 1, 3, 0, 2 }, { 2, 3, 0, 1 } } ;
+   int near = 0 ;
+   for (int j=0; j<4; j++) {
+      int i = order[side][j] ;
+      if (c[i] == z)
+         continue ;
+      if (j < 2) {
+         near = 1 ;
+      } else if (near || h >= r) {
+         break ;
+      }
+      long long off = (j < 2) ? 0 : h ;
+      long long v = off + ((depth == 2) ? leafedge((leaf *)c[i], side)
+                                    : nodeedge(c[i], depth, side, r - off)) ;
+      if (v < r)
+         r = v ;
+   }
+   if (m == 0 || r >= limit)
+      return r ;
+   m = &edgememo[edgememoslot(root)] ;
+   if (m->n != root) {
+      m->n = root ;
+      m->e[0] = m->e[1] = m->e[2] = m->e[3] = -1 ;
+   }
+   m->e[side] = r ;
+   return r ;
+}
+int hlifealgo::nodeedges(node *root, int depth, long long *e) {
+   int i ;
+   if (depth > EDGEMAXDEPTH)
+      return 0 ;
+   if (depth > 2 && edgememo.empty())
+      edgememo.resize((size_t)1 << EDGEMEMOBITS) ;
+   for (i=0; i<4; i++)
+      e[i] = (depth == 2) ? leafedge((leaf *)root, i)
+                          : nodeedge(root, depth, i, 1LL << 62) ;
+   // turn the right and bottom distances into columns and rows
+   e[2] = (1LL << (depth + 1)) - 1 - e[2] ;
+   e[3] = (1LL << (depth + 1)) - 1 - e[3] ;
+   return 1 ;
 }
 /*
  *   Is the universe empty?
@@ -1209,6 +2492,13 @@ int hlifealgo::isEmpty() {
  *   This routine marks a node as needed to be saved.
  */
 node *hlifealgo::save(node *n) {
+   if (parallel) {
+      hlifeworker *w = curworker ;
+      if (w->gsp >= w->stacksize)
+         pool->growstack(w) ;
+      w->stack[w->gsp++] = n ;
+      return n ;
+   }
    if (gsp >= stacksize) {
       int nstacksize = stacksize * 2 + 100 ;
       alloced += sizeof(node *)*(nstacksize-stacksize) ;
@@ -1224,7 +2514,16 @@ node *hlifealgo::save(node *n) {
  *   This routine pops the stack back to a previous depth.
  */
 void hlifealgo::pop(int n) {
-   gsp = n ;
+   if (parallel)
+      curworker->gsp = n ;
+   else
+      gsp = n ;
+}
+/*
+ *   Where the stack is now, for a later pop().
+ */
+int hlifealgo::stackpos() {
+   return parallel ? curworker->gsp : gsp ;
 }
 /*
  *   This routine clears the stack altogether.
@@ -1234,10 +2533,9 @@ void hlifealgo::clearstack() {
 }
 /*
  *   Do a gc.  Walk down from all nodes reachable on the stack, saveing
- *   them by setting the odd bit on the next link.  Then, walk the hash,
- *   eliminating the res from everything that's not saveed, and moving
- *   the nodes from the hash to the freelist as appropriate.  Finally,
- *   walk the hash again, clearing the low order bits in the next pointers.
+ *   them by setting the odd bit on the next link.  Then, walk all the
+ *   nodes, rebuilding the hash from the saveed ones (clearing the odd
+ *   bits again) and moving the rest to the freelist.
  */
 void hlifealgo::gc_mark(node *root, int invalidate) {
    if (!marked(root)) {
@@ -1264,6 +2562,8 @@ void hlifealgo::do_gc(int invalidate) {
    int i ;
    g_uintptr_t freed_nodes=0 ;
    node *p, *pp ;
+   double t = gcclock() ;
+   gcabort() ;
    inGC = 1 ;
    gccount++ ;
    gcstep++ ;
@@ -1279,38 +2579,59 @@ void hlifealgo::do_gc(int invalidate) {
          break ;
    if (i >= 0)
       gc_mark(zeronodea[i], 0) ; // never invalidate zeronode
-   for (i=0; i<gsp; i++) {
-      poller->poll() ;
-      gc_mark(stack[i], invalidate) ;
-   }
+   vector<node *> roots(stack, stack + gsp) ;
    for (i=0; i<timeline.framecount; i++)
-      gc_mark((node *)timeline.frames[i], invalidate) ;
+      roots.push_back((node *)timeline.frames[i]) ;
+   if (parallel) {
+      for (size_t w=0; w<pool->workers.size(); w++) {
+         hlifeworker &wk = pool->workers[w] ;
+         roots.insert(roots.end(), wk.stack, wk.stack + wk.gsp) ;
+         wk.freenodes = 0 ;
+      }
+   }
+   int nthreads = 1 ;
+   if (numthreads > 1 && totalthings >= PARALLEL_GC_NODES)
+      nthreads = numthreads ;
+   if (nthreads == 1) {
+      for (size_t r=0; r<roots.size(); r++) {
+         poller->poll() ;
+         gc_mark(roots[r], invalidate) ;
+      }
+      keptmark(invalidate) ;
+   }
+   if (oldtab) { // everything we keep goes into the new table
+      free(oldmem) ;
+      alloced -= (oldmask + 2) * sizeof(hlifebucket) ;
+      oldtab = 0 ;
+      oldmem = 0 ;
+   }
    hashpop = 0 ;
-   memset(hashtab, 0, sizeof(node *) * hashprime) ;
+   memset(hashtab, 0, sizeof(hlifebucket) * (hashmask + 1)) ;
    freenodes = 0 ;
-   for (p=nodeblocks; p; p=p->next) {
-      poller->poll() ;
-      for (pp=p+1, i=1; i<1001; i++, pp++) {
-         if (marked(pp)) {
-            g_uintptr_t h = 0 ;
-            if (pp->nw) { /* yes, it's a node */
-               h = node_hash(pp->nw, pp->ne, pp->sw, pp->se) % hashprime ;
+   if (nthreads > 1) {
+      freed_nodes = gc_par(roots, invalidate, nthreads) ;
+   } else {
+      for (p=nodeblocks; p; p=p->next) {
+         poller->poll() ;
+         for (pp=p+1, i=1; i<=NODESPERBLOCK; i++, pp++) {
+            if (marked(pp)) {
+               if (!is_node(pp) && invalidate)
+                  newleafres((leaf *)pp) ;
+               pp->next = 0 ;
+               hashinsert(pp, parallel) ;
+               hashpop++ ;
             } else {
-               leaf *lp = (leaf *)pp ;
-               if (invalidate)
-                  leafres(lp) ;
-               h = leaf_hash(lp->nw, lp->ne, lp->sw, lp->se) % hashprime ;
+               pp->next = freenodes ;
+               freenodes = pp ;
+               freed_nodes++ ;
             }
-            pp->next = hashtab[h] ;
-            hashtab[h] = pp ;
-            hashpop++ ;
-         } else {
-            pp->next = freenodes ;
-            freenodes = pp ;
-            freed_nodes++ ;
          }
       }
    }
+   if (freed_nodes) {
+      popmemo.clear() ;
+      edgememo.clear() ;
+   }
    inGC = 0 ;
    if (verbose) {
      int perc = (int)(freed_nodes / (totalthings / 100)) ;
@@ -1318,6 +2639,7 @@ void hlifealgo::do_gc(int invalidate) {
                                                    perc, (int)freed_nodes) ;
      lifestatus(statusline) ;
    }
+   gcpaused(t) ;
    if (needPop) {
       calcPopulation(root) ;
       popValid = 1 ;
@@ -1325,6 +2647,597 @@ void hlifealgo::do_gc(int invalidate) {
       poller->updatePop() ;
    }
 }
+/*
+ *   A big gc with several threads marks and sweeps in parallel.  Each
+ *   thread marks depth-first from a stack of its own, claiming nodes by
+ *   setting their mark bit with a compare-and-swap (so only one thread
+ *   scans any node), and hands half its stack over when another thread
+ *   runs out of work.  Once every thread is out of work, each one
+ *   sweeps its share of the node blocks into the (already cleared)
+ *   hash and a free list of its own.
+ */
+struct hlifegc {
+   hlifegc(int n) : nthreads(n), idle(0), done(0), hungry(0),
+                    heads(n), tails(n), freed(n), kept(n) {}
+   std::mutex lock ;
+   std::condition_variable wake ;
+   vector<node *> shared ;     // claimed but not yet scanned
+   int nthreads, idle, done ;
+   volatile int hungry ;       // someone is waiting for work
+   int invalidate ;
+   vector<node *> blocks ;
+   vector<node *> heads, tails ;
+   vector<g_uintptr_t> freed, kept ;
+} ;
+static inline int gcclaim(node *n) {
+   for (;;) {
+#ifndef HLIFECOMPACT
+      node *o = n->next ;
+      if (1 & (g_uintptr_t)o)
+         return 0 ;
+      if (g_cas_ptr(&n->next, o, (node *)(1 | (g_uintptr_t)o)))
+         return 1 ;
+#else
+      unsigned int o = n->next.i ;
+      if (o & 1)
+         return 0 ;
+      if (g_cas_32(&n->next.i, o, o | 1))
+         return 1 ;
+#endif
+   }
+}
+g_uintptr_t hlifealgo::gc_par(vector<node *> &roots, int invalidate,
+                              int nthreads) {
+   hlifegc g(nthreads) ;
+   g.invalidate = invalidate ;
+   for (size_t r=0; r<roots.size(); r++)
+      if (gcclaim(roots[r]) && is_node(roots[r]))
+         g.shared.push_back(roots[r]) ;
+   for (node *p=nodeblocks; p; p=p->next)
+      g.blocks.push_back(p) ;
+   vector<std::thread> threads ;
+   for (int t=1; t<nthreads; t++)
+      threads.push_back(std::thread(&hlifealgo::gc_par_mark, this, &g, t)) ;
+   gc_par_mark(&g, 0) ;
+   for (size_t t=0; t<threads.size(); t++)
+      threads[t].join() ;
+   keptmark(invalidate) ;
+   threads.clear() ;
+   for (int t=1; t<nthreads; t++)
+      threads.push_back(std::thread(&hlifealgo::gc_par_sweep, this, &g, t)) ;
+   gc_par_sweep(&g, 0) ;
+   for (size_t t=0; t<threads.size(); t++)
+      threads[t].join() ;
+   g_uintptr_t freed_nodes = 0 ;
+   for (int t=0; t<nthreads; t++) {
+      if (g.heads[t]) {
+         g.tails[t]->next = freenodes ;
+         freenodes = g.heads[t] ;
+      }
+      freed_nodes += g.freed[t] ;
+      hashpop += g.kept[t] ;
+   }
+   return freed_nodes ;
+}
+void hlifealgo::gc_par_mark(hlifegc *g, int t) {
+   vector<node *> todo ;
+   for (;;) {
+      if (todo.empty()) {
+         std::unique_lock<std::mutex> lk(g->lock) ;
+         while (g->shared.empty() && !g->done) {
+            if (++g->idle == g->nthreads) {
+               g->done = 1 ;
+               g->wake.notify_all() ;
+               break ;
+            }
+            g->hungry = 1 ;
+            g->wake.wait(lk) ;
+            g->idle-- ;
+         }
+         if (g->done)
+            break ;
+         size_t k = g->shared.size() > 64 ? g->shared.size() - 64 : 0 ;
+         todo.assign(g->shared.begin() + k, g->shared.end()) ;
+         g->shared.resize(k) ;
+         continue ;
+      }
+      node *n = todo.back() ;
+      todo.pop_back() ;
+      node *c[5] = { n->nw, n->ne, n->sw, n->se, n->res } ;
+      if (c[4] && g->invalidate) {
+         n->res = 0 ;
+         c[4] = 0 ;
+      }
+      for (int i=0; i<5; i++)
+         if (c[i] && gcclaim(c[i]) && is_node(c[i]))
+            todo.push_back(c[i]) ;
+      if (g->hungry && todo.size() > 32) {
+         // give away the bottom half; those are the biggest subtrees
+         std::unique_lock<std::mutex> lk(g->lock) ;
+         size_t k = todo.size() / 2 ;
+         g->shared.insert(g->shared.end(), todo.begin(), todo.begin() + k) ;
+         todo.erase(todo.begin(), todo.begin() + k) ;
+         g->hungry = 0 ;
+         g->wake.notify_all() ;
+      }
+   }
+}
+void hlifealgo::gc_par_sweep(hlifegc *g, int t) {
+   node *head = 0, *tail = 0 ;
+   g_uintptr_t freed = 0, kept = 0 ;
+   size_t nb = g->blocks.size() ;
+   for (size_t b = nb * t / g->nthreads ; b < nb * (t + 1) / g->nthreads ; b++) {
+      if (t == 0)
+         poller->poll() ;
+      node *pp = g->blocks[b] + 1 ;
+      for (int i=1; i<=NODESPERBLOCK; i++, pp++) {
+         if (marked(pp)) {
+            if (!is_node(pp) && g->invalidate)
+               newleafres((leaf *)pp) ;
+            pp->next = 0 ;
+            hashinsert(pp, 1) ;
+            kept++ ;
+         } else {
+            if (head == 0)
+               tail = pp ;
+            pp->next = head ;
+            head = pp ;
+            freed++ ;
+         }
+      }
+   }
+   g->heads[t] = head ;
+   g->tails[t] = tail ;
+   g->freed[t] = freed ;
+   g->kept[t] = kept ;
+}
+/*
+ *   Keep track of the longest time a gc held up the calculation.
+ */
+void hlifealgo::gcpaused(double since) {
+   double t = gcclock() - since ;
+   if (t > gcmaxpause)
+      gcmaxpause = t ;
+}
+/*
+ *   Incremental collection.  Rather than stop everything to mark and
+ *   sweep when memory runs out, we start a cycle a little before that
+ *   and do a bit of it every time we add a node to the hash, at a pace
+ *   that should finish the cycle before we run out of headroom.
+ *
+ *   Marking works from a snapshot:  whatever is reachable from the
+ *   roots when the cycle starts gets marked (nodes never change apart
+ *   from their res fields, so it stays reachable), and so does every
+ *   node built or found in the hash during the cycle, since we may hang
+ *   on to it.  New nodes are born marked.  While marking we also drop
+ *   the results of nodes nobody has asked since the last cycle, which
+ *   is what keeps the cache from filling up with results of long-gone
+ *   generations; so that a result we drop can't still be in use,
+ *   getres() saves everything it returns while this is going on.
+ *
+ *   Then we sweep the hash a bucket at a time, freeing what wasn't
+ *   marked.  A search that runs into such a node before the sweep does
+ *   must not use it (its children may be gone), so it sweeps that
+ *   bucket early.
+ *
+ *   Cycles only run while we're single-threaded; the pool still uses
+ *   do_gc().
+ */
+void hlifealgo::setIncrementalGC(int on) {
+   poller->bailIfCalculating() ;
+   if (!on)
+      gcabort() ;
+   gcincremental = on ;
+   gctrack = on && !parallel ;
+}
+/*
+ *   The free list is about to run dry.  Start a cycle if we're within
+ *   the headroom; if we're at the limit and one is still going, finish
+ *   it now.
+ */
+void hlifealgo::gcroom() {
+   g_uintptr_t need = memused(NODESPERBLOCK) ;
+   if (gcphase == GCIDLE) {
+      if (need > maxmem - maxmem / GCHEADROOM)
+         gcstart() ;
+   } else if (need > maxmem) {
+      gcfinish() ;
+   }
+}
+void hlifealgo::gcstart() {
+   int i ;
+   double t = gcclock() ;
+   if (++gcepoch >= GCEPOCHMAX) { // out of cycle numbers; start over
+      do_gc(0) ;
+      gcepoch = 0 ;
+      return ;
+   }
+   gcphase = GCMARK ;
+   gcfreed = 0 ;
+   for (i=nzeros-1; i>=0; i--)
+      if (zeronodea[i] != 0)
+         break ;
+   if (i >= 0)
+      gcshade(zeronodea[i]) ;
+   for (i=0; i<gsp; i++)
+      gcshade(stack[i]) ;
+   for (i=0; i<timeline.framecount; i++)
+      gcshade((node *)timeline.frames[i]) ;
+   // marking touches at most every node, and sweeping every bucket
+   g_uintptr_t work = hashpop + hashmask + 1 ;
+   if (oldtab)
+      work += oldmask + 1 - oldcursor ;
+   g_uintptr_t used = memused(0) ;
+   g_uintptr_t room = (maxmem > used ? maxmem - used : 0) / sizeof(node) ;
+   gcpace = 1 + 2 * work / (room + 1) ;
+   gcpaused(t) ;
+}
+void hlifealgo::gcshade(node *n) {
+   if (!gclive(n)) {
+      setgcword(n, (gcepoch << 2) | (gcword(n) & GCUSED)) ;
+      if (is_node(n))
+         gcgray.push_back(n) ;
+   }
+}
+void hlifealgo::gcscan(node *n) {
+   gcshade(n->nw) ;
+   gcshade(n->ne) ;
+   gcshade(n->sw) ;
+   gcshade(n->se) ;
+   if (n->res) {
+      if (1 || (gcword(n) & GCUSED))
+         gcshade(n->res) ;
+      else
+         n->res = 0 ;
+   }
+   setgcword(n, gcword(n) & ~(g_uintptr_t)GCUSED) ;
+}
+void hlifealgo::gcfree(node *n) {
+   n->next = freenodes ;
+   freenodes = n ;
+   hashpop-- ;
+   gcfreed++ ;
+}
+/*
+ *   Free the unmarked nodes in bucket h, keeping its slots in order.
+ */
+void hlifealgo::gcsweepbucket(g_uintptr_t h) {
+   hlifebucket *b = hashtab + h ;
+   int full = (b->slot[HBSLOTS-1] != 0) ;
+   int i, j = 0 ;
+   for (i=0; i<HBSLOTS && b->slot[i]; i++) {
+      node *p = slotnode(b->slot[i]) ;
+      if (gclive(p)) {
+         b->slot[j] = b->slot[i] ;
+         b->tag[j++] = b->tag[i] ;
+      } else {
+         gcfree(p) ;
+      }
+   }
+   if (j == i)
+      return ;
+   for (; j<i; j++) {
+      b->slot[j] = 0 ;
+      b->tag[j] = 0 ;
+   }
+   if (full)
+      gcrehash(h) ;
+}
+/*
+ *   Bucket h was full, so later entries may have been pushed past it
+ *   and a search for them would now stop short.  Take out everything
+ *   from there up to the next bucket that wasn't full and put it back
+ *   (freeing any garbage we run into on the way).
+ */
+void hlifealgo::gcrehash(g_uintptr_t h) {
+   gcmoved.clear() ;
+   for (g_uintptr_t c = (h + 1) & hashmask ; ; c = (c + 1) & hashmask) {
+      hlifebucket *b = hashtab + c ;
+      int full = (b->slot[HBSLOTS-1] != 0) ;
+      for (int i=0; i<HBSLOTS && b->slot[i]; i++) {
+         node *p = slotnode(b->slot[i]) ;
+         b->slot[i] = 0 ;
+         b->tag[i] = 0 ;
+         if (gclive(p))
+            gcmoved.push_back(p) ;
+         else
+            gcfree(p) ;
+      }
+      if (!full)
+         break ;
+   }
+   for (size_t i=0; i<gcmoved.size(); i++)
+      hashinsert(gcmoved[i], 0) ;
+}
+/*
+ *   Do n units of work on the current cycle.  The sweep only looks at
+ *   the current table, so a resize in progress has to finish first.
+ */
+void hlifealgo::gcwork(g_uintptr_t n) {
+   while (n > 0 && gcphase == GCMARK) {
+      if (!gcgray.empty()) {
+         node *p = gcgray.back() ;
+         gcgray.pop_back() ;
+         gcscan(p) ;
+         n-- ;
+      } else if (oldtab) {
+         int k = (n < 64) ? (int)n : 64 ;
+         migrate(k) ;
+         n -= k ;
+         if (oldcursor > oldmask)
+            finishresize() ;
+      } else if (!gckept()) {
+         gcphase = GCSWEEP ;
+         gccursor = 0 ;
+      }
+   }
+   while (n > 0 && gcphase == GCSWEEP) {
+      gcsweepbucket(gccursor++) ;
+      n-- ;
+      if (gccursor > hashmask)
+         gcdone() ;
+   }
+}
+void hlifealgo::gcdone() {
+   gcphase = GCIDLE ;
+   if (gcfreed) {
+      popmemo.clear() ;
+      edgememo.clear() ;
+   }
+   gccount++ ;
+   gcstep++ ;
+   if (verbose) {
+     int perc = (int)(gcfreed / (totalthings / 100)) ;
+     sprintf(statusline, "GC #%d (incremental) freed %d percent (%d).",
+                                            gccount, perc, (int)gcfreed) ;
+     lifestatus(statusline) ;
+   }
+   if (needPop) {
+      calcPopulation(root) ;
+      popValid = 1 ;
+      needPop = 0 ;
+      poller->updatePop() ;
+   }
+}
+/*
+ *   Do the rest of the current cycle right now.
+ */
+void hlifealgo::gcfinish() {
+   double t = gcclock() ;
+   while (gcphase) {
+      poller->poll() ;
+      gcwork(4096) ;
+   }
+   gcpaused(t) ;
+}
+/*
+ *   Something is about to use the next fields for its own purposes.
+ *   Marking can simply be abandoned, but a sweep has to be finished.
+ */
+void hlifealgo::gcabort() {
+   if (gcphase == GCMARK) {
+      gcgray.clear() ;
+      gcphase = GCIDLE ;
+   } else if (gcphase == GCSWEEP) {
+      gcfinish() ;
+   }
+}
+/*
+ *   When the step size changes we can put the results that no longer
+ *   apply aside, rather than throw them away, so changing back is
+ *   quick.  keptres holds the results for up to stepcaches step sizes
+ *   (the most recent last), as pairs of node and result, and keptgens
+ *   the ngens value for each.
+ *
+ *   keptswap() is called after new_ngens() has cleared the results
+ *   (into keeping); it puts those aside for the old step size, and
+ *   puts back any we have for the new one.
+ *
+ *   The same goes for the rule:  with rulecaches set, clearcache()
+ *   puts all the results we have aside for the old rule rather than
+ *   dropping them, and once do_gc(1) has thrown away what was left in
+ *   the nodes, keptrestore() puts back any we have for the new one.
+ *   keptrules has the rule for each entry, and rulekey the rule the
+ *   results in the nodes are for (unless cacheinvalid is set); the
+ *   parity is part of it, since a B0 rule's results depend on it.
+ *   Nodes are shared by all the rules; only the results are not.
+ */
+void hlifealgo::setStepCaches(int n) {
+   poller->bailIfCalculating() ;
+   stepcaches = (n < 0) ? 0 : n ;
+   keptlimit() ;
+}
+void hlifealgo::setRuleCaches(int n) {
+   poller->bailIfCalculating() ;
+   rulecaches = (n < 0) ? 0 : n ;
+   keptlimit() ;
+}
+void hlifealgo::keptswap(int oldngens) {
+   if (cacheinvalid) // keep what we have until keptrestore()
+      return ;
+   for (size_t i=0; i<keptgens.size(); i++) {
+      if (keptgens[i] == oldngens && keptrules[i] == rulekey) {
+         keptres.erase(keptres.begin() + i) ;
+         keptgens.erase(keptgens.begin() + i) ;
+         keptrules.erase(keptrules.begin() + i) ;
+         i-- ;
+      }
+   }
+   keptrestore() ;
+   if (!keeping.empty()) {
+      keptres.push_back(vector<node *>()) ;
+      keptres.back().swap(keeping) ;
+      keptgens.push_back(oldngens) ;
+      keptrules.push_back(rulekey) ;
+   }
+   keptlimit() ;
+}
+/*
+ *   Put the results in the nodes aside for the rule they are for.
+ */
+void hlifealgo::keptrule() {
+   if (cacheinvalid)
+      return ;
+   gcabort() ;
+   if (oldtab)
+      finishresize() ;
+   vector<node *> v ;
+   for (g_uintptr_t i=0; i<=hashmask; i++) {
+      node *p ;
+      for (int j=0; j<HBSLOTS && hashtab[i].slot[j]; j++)
+         if (is_node(p=slotnode(hashtab[i].slot[j])) && p->res) {
+            v.push_back(p) ;
+            v.push_back(p->res) ;
+         }
+   }
+   if (!v.empty()) {
+      keptres.push_back(vector<node *>()) ;
+      keptres.back().swap(v) ;
+      keptgens.push_back(ngens) ;
+      keptrules.push_back(rulekey) ;
+   }
+}
+/*
+ *   The results in the nodes are now valid for the current rule and
+ *   step size; put back any we have kept for them.
+ */
+void hlifealgo::keptrestore() {
+   rulekey = hliferules.getrule() ;
+   if (ruleparity)
+      rulekey += " odd" ;
+   for (size_t i=0; i<keptgens.size(); i++) {
+      if (keptgens[i] == ngens && keptrules[i] == rulekey) {
+         vector<node *> &v = keptres[i] ;
+         for (size_t j=0; j<v.size(); j+=2)
+            if (v[j]->res == 0) {
+               v[j]->res = v[j+1] ;
+               halvesdone = 1 ; // so we clear them again next time
+            }
+         keptres.erase(keptres.begin() + i) ;
+         keptgens.erase(keptgens.begin() + i) ;
+         keptrules.erase(keptrules.begin() + i) ;
+         break ;
+      }
+   }
+   keptaccount() ;
+}
+/*
+ *   Drop the oldest entries beyond stepcaches for the current rule and
+ *   beyond rulecaches other rules, each of which keeps its own results
+ *   plus up to stepcaches other step sizes.
+ */
+void hlifealgo::keptlimit() {
+   vector<std::string> others ; // most recent first
+   vector<int> count ;
+   int mine = 0 ;
+   for (int i=(int)keptres.size()-1; i>=0; i--) {
+      int keep ;
+      if (!cacheinvalid && keptrules[i] == rulekey) {
+         keep = (++mine <= stepcaches) ;
+      } else {
+         size_t r = 0 ;
+         while (r < others.size() && others[r] != keptrules[i])
+            r++ ;
+         if (r == others.size()) {
+            others.push_back(keptrules[i]) ;
+            count.push_back(0) ;
+         }
+         keep = ((int)r < rulecaches && ++count[r] <= stepcaches + 1) ;
+      }
+      if (!keep) {
+         keptres.erase(keptres.begin() + i) ;
+         keptgens.erase(keptgens.begin() + i) ;
+         keptrules.erase(keptrules.begin() + i) ;
+      }
+   }
+   keptaccount() ;
+}
+void hlifealgo::keptaccount() {
+   alloced -= keptbytes ;
+   keptbytes = 0 ;
+   for (size_t i=0; i<keptres.size(); i++)
+      keptbytes += keptres[i].capacity() * sizeof(node *) ;
+   alloced += keptbytes ;
+}
+/*
+ *   Results we've put aside keep their result alive as long as the node
+ *   itself is, but don't keep the node alive.  So a gc calls this once
+ *   everything else is marked, to mark the results of the nodes that
+ *   made it and drop the rest.  A result can be the node of another
+ *   pair (the next step from it), so we go round until nothing more
+ *   gets marked.
+ *
+ *   The gc that follows a rule change is the exception:  most of the
+ *   nodes a rule's results need (the bigger squares runpattern() builds
+ *   around the root, and the pieces of every step) are reachable from
+ *   nothing else, so that one keeps all the kept nodes alive.  If
+ *   memory then runs out, the next gc is an ordinary one and lets them
+ *   go.  Anything marked here only has results for another rule, so
+ *   we clear those as the marking of the roots did.
+ */
+void hlifealgo::keptmark(int invalidate) {
+   if (keptres.empty())
+      return ;
+   if (invalidate) {
+      for (size_t i=0; i<keptres.size(); i++) {
+         vector<node *> &v = keptres[i] ;
+         for (size_t j=0; j<v.size(); j++)
+            gc_mark(v[j], invalidate) ;
+      }
+   }
+   for (int more=1; more; ) {
+      more = 0 ;
+      for (size_t i=0; i<keptres.size(); i++) {
+         vector<node *> &v = keptres[i] ;
+         for (size_t j=0; j<v.size(); j+=2)
+            if (marked(v[j]) && !marked(v[j+1])) {
+               gc_mark(v[j+1], invalidate) ;
+               more = 1 ;
+            }
+      }
+   }
+   for (size_t i=0; i<keptres.size(); i++) {
+      vector<node *> &v = keptres[i] ;
+      size_t k = 0 ;
+      for (size_t j=0; j<v.size(); j+=2) {
+         if (marked(v[j])) {
+            v[k++] = v[j] ;
+            v[k++] = v[j+1] ;
+         }
+      }
+      v.resize(k) ;
+   }
+   keptaccount() ;
+}
+/*
+ *   The same for an incremental cycle, once the marking is otherwise
+ *   done.  Returns nonzero if that found more to mark.
+ */
+int hlifealgo::gckept() {
+   int more = 0 ;
+   for (size_t i=0; i<keptres.size(); i++) {
+      vector<node *> &v = keptres[i] ;
+      for (size_t j=0; j<v.size(); j+=2)
+         if (gclive(v[j]) && !gclive(v[j+1])) {
+            gcshade(v[j+1]) ;
+            more = 1 ;
+         }
+   }
+   if (more)
+      return 1 ;
+   for (size_t i=0; i<keptres.size(); i++) {
+      vector<node *> &v = keptres[i] ;
+      size_t k = 0 ;
+      for (size_t j=0; j<v.size(); j+=2) {
+         if (gclive(v[j])) {
+            v[k++] = v[j] ;
+            v[k++] = v[j+1] ;
+         }
+      }
+      v.resize(k) ;
+   }
+   return 0 ;
+}
 /*
  *   Clear the cache bits down to the appropriate level, marking the
  *   nodes we've handled.
@@ -1342,8 +3255,13 @@ void hlifealgo::clearcache(node *n, int depth, int clearto) {
          if (n->res)
             clearcache(n->res, depth, clearto) ;
       }
-      if (depth >= clearto)
+      if (depth >= clearto) {
+         if (stepcaches && n->res && !cacheinvalid) {
+            keeping.push_back(n) ;
+            keeping.push_back(n->res) ;
+         }
          n->res = 0 ;
+      }
    }
 }
 /*
@@ -1351,7 +3269,15 @@ void hlifealgo::clearcache(node *n, int depth, int clearto) {
  *   This can be very expensive.
  */
 void hlifealgo::clearcache() {
+   if (rulecaches) {
+      keptrule() ;
+   } else {
+      keptres.clear() ;
+      keptgens.clear() ;
+      keptrules.clear() ;
+   }
    cacheinvalid = 1 ;
+   keptlimit() ;
 }
 /*
  *   Change the ngens value.  Requires us to walk the hash, clearing
@@ -1361,9 +3287,11 @@ void hlifealgo::clearcache() {
 void hlifealgo::new_ngens(int newval) {
    g_uintptr_t i ;
    node *p, *pp ;
-   int clearto = ngens ;
+   int clearto = ngens, oldngens = ngens ;
    if (newval > ngens && halvesdone == 0) {
       ngens = newval ;
+      if (stepcaches)
+         keptswap(oldngens) ;
       return ;
    }
    if (verbose) {
@@ -1376,17 +3304,22 @@ void hlifealgo::new_ngens(int newval) {
    if (clearto < 3)
       clearto = 3 ;
    ngens = newval ;
+   gcabort() ;
    inGC = 1 ;
-   for (i=0; i<hashprime; i++)
-      for (p=hashtab[i]; p; p=clearmarkbit(p->next))
-         if (is_node(p) && !marked(p))
+   if (oldtab)
+      finishresize() ;
+   for (i=0; i<=hashmask; i++)
+      for (int j=0; j<HBSLOTS && hashtab[i].slot[j]; j++)
+         if (is_node(p=slotnode(hashtab[i].slot[j])) && !marked(p))
             clearcache(p, node_depth(p), clearto) ;
    for (p=nodeblocks; p; p=p->next) {
       poller->poll() ;
-      for (pp=p+1, i=1; i<1001; i++, pp++)
+      for (pp=p+1, i=1; i<=NODESPERBLOCK; i++, pp++)
          clearmark(pp) ;
    }
    halvesdone = 0 ;
+   if (stepcaches)
+      keptswap(oldngens) ;
    inGC = 0 ;
    if (needPop) {
       calcPopulation(root) ;
@@ -1447,6 +3380,7 @@ node *hlifealgo::runpattern() {
    if (cacheinvalid) {
       do_gc(1) ; // invalidate the entire cache and recalc leaves
       cacheinvalid = 0 ;
+      keptrestore() ;
    }
    int depth = node_depth(n) ;
    node *n2 ;
@@ -1460,7 +3394,15 @@ node *hlifealgo::runpattern() {
    }
    save(zeronode(nzeros-1)) ;
    save(n) ;
-   n2 = getres(n, depth) ;
+   if (numthreads > 1 && pool == 0)
+      startthreads() ;
+   if (pool && depth > PARALLEL_DEPTH) {
+      beginparallel() ;
+      n2 = getres(n, depth) ;
+      endparallel() ;
+   } else {
+      n2 = getres(n, depth) ;
+   }
    okaytogc = 0 ;
    clearstack() ;
    if (halvesdone == 1) {
@@ -1473,6 +3415,420 @@ node *hlifealgo::runpattern() {
    generation += pow2step ;
    return n ;
 }
+/*
+ *   Decide whether we step the grid ourselves; called whenever the rule
+ *   (and with it the grid) may have changed.
+ */
+void hlifealgo::setbounded() {
+   if ((gridwd == 0 && gridht == 0) || sphere || htwist || vtwist ||
+       hshift != 0 || vshift != 0 || hliferules.alternate_rules) {
+      delete bound ;
+      bound = 0 ;
+   } else {
+      if (bound == 0)
+         bound = new hlifebound ;
+      bound->plane = boundedplane ;
+      bound->wd = gridwd ;
+      bound->ht = gridht ;
+      bound->left = gridwd ? gridleft.toint() : 0 ;
+      bound->right = gridwd ? gridright.toint() : 0 ;
+      // rows here count down from the top of the tree, one above the
+      // cell coordinates (see setcell())
+      bound->top = gridht ? gridtop.toint() - 1 : 0 ;
+      bound->bottom = gridht ? gridbottom.toint() - 1 : 0 ;
+      bound->cap = BOUNDMAXDEPTH ;
+      if (!boundedplane && ((gridwd & (gridwd - 1)) || (gridht & (gridht - 1)))) {
+         bound->cap = 0 ;
+         while ((1LL << bound->cap) < (long long)gridwd ||
+                (1LL << bound->cap) < (long long)gridht)
+            bound->cap++ ;
+      }
+   }
+   setincrement = 0 ; // so step() works out ngens (and boundextra) again
+}
+/*
+ *   The cells of row y from x to x+n-1 that are inside the grid, the
+ *   first in the high bit.
+ */
+static unsigned int boundmask(hlifebound *b, long long x, long long y, int n) {
+   if (b->ht && (y < b->top || y > b->bottom))
+      return 0 ;
+   unsigned int m = (1U << n) - 1 ;
+   if (b->wd)
+      for (int i=0; i<n; i++)
+         if (x + i < b->left || x + i > b->right)
+            m &= ~(1U << (n - 1 - i)) ;
+   return m ;
+}
+/*
+ *   Row i of a leaf, the first cell in the high bit.
+ */
+static inline unsigned int leafrow(leaf *l, int i) {
+   int s = 12 - 4 * (i & 3) ;
+   if (i < 4)
+      return (((l->nw >> s) & 0xf) << 4) | ((l->ne >> s) & 0xf) ;
+   return (((l->sw >> s) & 0xf) << 4) | ((l->se >> s) & 0xf) ;
+}
+/*
+ *   Step a bounded grid; like runpattern(), return the new root, or zero
+ *   if we were interrupted.
+ */
+node *hlifealgo::boundedstep() {
+   ensure_hashed() ;
+   save(root) ;
+   okaytogc = 1 ;
+   if (cacheinvalid) {
+      do_gc(1) ; // invalidate the entire cache and recalc leaves
+      cacheinvalid = 0 ;
+      keptrestore() ;
+   }
+   if (numthreads > 1 && pool == 0)
+      startthreads() ;
+   int d = node_depth(root) ;
+   long long c = -(1LL << d) ;
+   node *n = boundstep(popzeros(clipnode(root, d, c, c)), boundextra) ;
+   okaytogc = 0 ;
+   clearstack() ;
+   bound->res.clear() ;
+   bound->tiles.clear() ;
+   bound->steps.clear() ;
+   if (poller->isInterrupted())
+      return 0 ;
+   generation += pow2step ;
+   return n ;
+}
+/*
+ *   Run n forward 2**(ngens+extra) generations.
+ */
+node *hlifealgo::boundstep(node *n, int extra) {
+   if (poller->isInterrupted())
+      return n ;
+   if (extra == 0) {
+      int sp = stackpos() ;
+      node *r = bound->plane ? planestep(n) : torusstep(n) ;
+      pop(sp) ;
+      bound->res.clear() ;
+      bound->tiles.clear() ;
+      return save(r) ;
+   }
+   hlifeboundkey k = { n, extra, 0, 0 } ;
+   hlifeboundmap::iterator it = bound->steps.find(k) ;
+   if (it != bound->steps.end())
+      return it->second ;
+   node *r = boundstep(boundstep(n, extra-1), extra-1) ;
+   if (!poller->isInterrupted())
+      bound->steps[k] = r ;
+   return r ;
+}
+node *hlifealgo::torusstep(node *n) {
+   hlifebound *b = bound ;
+   b->rootnode = n ;
+   b->rootdepth = node_depth(n) ;
+   b->last = 0 ;
+   int d = ngens + 2 ;
+   if (d < 3)
+      d = 3 ;
+   if ((b->wd == 0 || b->ht == 0) && d < b->rootdepth + 2)
+      d = b->rootdepth + 2 ;
+   while ((b->wd && ((1LL << (d-1)) < -b->left || (1LL << (d-1)) <= b->right)) ||
+          (b->ht && ((1LL << (d-1)) < -b->top || (1LL << (d-1)) <= b->bottom)))
+      d++ ;
+   long long c = -(1LL << d) ;
+   node *t = tilenode(d, c, c) ;
+   node *r ;
+   if (pool && d > PARALLEL_DEPTH) {
+      beginparallel() ;
+      r = getres(t, d) ;
+      endparallel() ;
+   } else {
+      r = getres(t, d) ;
+   }
+   save(r) ;
+   if (halvesdone == 1) {
+      t->res = 0 ;
+      halvesdone = 0 ;
+   }
+   return popzeros(clipnode(r, d-1, c/2, c/2)) ;
+}
+node *hlifealgo::planestep(node *n) {
+   int d = node_depth(n) + 2 ;
+   n = pushroot(pushroot(n)) ;
+   while (ngens + 2 > d) {
+      n = pushroot(n) ;
+      d++ ;
+   }
+   long long c = -(1LL << d) ;
+   node *r = boundres(n, d, c, c) ;
+   if (halvesdone == 1) {
+      n->res = 0 ;
+      halvesdone = 0 ;
+   }
+   return popzeros(r) ;
+}
+/*
+ *   The node of the given depth whose upper left corner is at x, y in
+ *   the endless tiling of the torus.
+ */
+node *hlifealgo::tilenode(int d, long long x, long long y) {
+   hlifebound *b = bound ;
+   if (b->wd)
+      x = b->left + ((x - b->left) % b->wd + b->wd) % b->wd ;
+   if (b->ht)
+      y = b->top + ((y - b->top) % b->ht + b->ht) % b->ht ;
+   long long size = 1LL << (d + 1), rs = 1LL << b->rootdepth ;
+   int inside = (b->wd == 0 || x + size - 1 <= b->right) &&
+                (b->ht == 0 || y + size - 1 <= b->bottom) ;
+   if (inside && (x >= rs || y >= rs || x + size <= -rs || y + size <= -rs))
+      return zeronode(d) ;
+   hlifeboundkey k = { 0, d, x, y } ;
+   hlifeboundmap::iterator it = b->tiles.find(k) ;
+   if (it != b->tiles.end())
+      return it->second ;
+   node *r ;
+   if (inside && d <= b->rootdepth && (x + rs) % size == 0 &&
+       (y + rs) % size == 0) {
+      // it lines up with the pattern's own tree
+      long long ox = -rs, oy = -rs ;
+      r = b->rootnode ;
+      for (int i=b->rootdepth; i>d; i--) {
+         long long h = 1LL << i ;
+         if (y < oy + h)
+            r = (x < ox + h) ? r->nw : r->ne ;
+         else
+            r = (x < ox + h) ? r->sw : r->se ;
+         if (x >= ox + h)
+            ox += h ;
+         if (y >= oy + h)
+            oy += h ;
+      }
+   } else if (d == 2) {
+      unsigned short q[4] = { 0, 0, 0, 0 } ;
+      for (int i=0; i<8; i++) {
+         unsigned int row = tilerow(x, y + i) ;
+         int s = 12 - 4 * (i & 3) ;
+         q[(i >> 2) * 2] |= ((row >> 4) & 0xf) << s ;
+         q[(i >> 2) * 2 + 1] |= (row & 0xf) << s ;
+      }
+      r = (node *)find_leaf(q[0], q[1], q[2], q[3]) ;
+   } else {
+      long long h = 1LL << d ;
+      r = find_node(tilenode(d-1, x, y), tilenode(d-1, x + h, y),
+                    tilenode(d-1, x, y + h), tilenode(d-1, x + h, y + h)) ;
+   }
+   b->tiles[k] = save(r) ;
+   return r ;
+}
+/*
+ *   The leaf of the pattern holding x, y (x a multiple of eight).
+ */
+leaf *hlifealgo::leafat(long long x, long long y) {
+   hlifebound *b = bound ;
+   y &= ~7LL ;
+   if (b->last && x == b->lastx && y == b->lasty)
+      return b->last ;
+   long long rs = 1LL << b->rootdepth ;
+   node *r = zeronode(2) ;
+   if (x >= -rs && y >= -rs && x < rs && y < rs) {
+      long long ox = -rs, oy = -rs ;
+      r = b->rootnode ;
+      for (int i=b->rootdepth; i>2; i--) {
+         long long h = 1LL << i ;
+         if (y < oy + h)
+            r = (x < ox + h) ? r->nw : r->ne ;
+         else
+            r = (x < ox + h) ? r->sw : r->se ;
+         if (x >= ox + h)
+            ox += h ;
+         if (y >= oy + h)
+            oy += h ;
+      }
+   }
+   b->last = (leaf *)r ;
+   b->lastx = x ;
+   b->lasty = y ;
+   return b->last ;
+}
+/*
+ *   Eight cells of row y of the pattern starting at x, the first in the
+ *   high bit.
+ */
+unsigned int hlifealgo::rowat(long long x, long long y) {
+   long long lx = x & ~7LL ;
+   int sh = (int)(x - lx) ;
+   unsigned int r = leafrow(leafat(lx, y), (int)(y & 7)) << 8 ;
+   if (sh)
+      r |= leafrow(leafat(lx + 8, y), (int)(y & 7)) ;
+   return (r >> (8 - sh)) & 0xff ;
+}
+/*
+ *   Same, but for the tiling, so the row may wrap around (x must be in
+ *   the grid already).
+ */
+unsigned int hlifealgo::tilerow(long long x, long long y) {
+   hlifebound *b = bound ;
+   if (b->ht)
+      y = b->top + ((y - b->top) % b->ht + b->ht) % b->ht ;
+   if (b->wd == 0 || x + 7 <= b->right)
+      return rowat(x, y) ;
+   if (b->wd >= 8) {
+      int k = (int)(b->right - x + 1) ; // cells before we wrap
+      return (rowat(x, y) & (0xff00 >> k) & 0xff) | (rowat(b->left, y) >> k) ;
+   }
+   unsigned int r = 0 ;
+   for (int i=0; i<8; i++) {
+      long long xx = b->left + (x - b->left + i) % b->wd ;
+      r |= ((rowat(xx, y) >> 7) & 1) << (7 - i) ;
+   }
+   return r ;
+}
+/*
+ *   Clear whatever part of a node lies outside the grid.
+ */
+node *hlifealgo::clipnode(node *n, int d, long long x, long long y) {
+   hlifebound *b = bound ;
+   long long size = 1LL << (d + 1) ;
+   if (n == zeronode(d))
+      return n ;
+   if ((b->wd == 0 || (x >= b->left && x + size - 1 <= b->right)) &&
+       (b->ht == 0 || (y >= b->top && y + size - 1 <= b->bottom)))
+      return n ;
+   if ((b->wd && (x > b->right || x + size - 1 < b->left)) ||
+       (b->ht && (y > b->bottom || y + size - 1 < b->top)))
+      return zeronode(d) ;
+   if (d == 2) {
+      leaf *l = (leaf *)n ;
+      unsigned short q[4] = { l->nw, l->ne, l->sw, l->se } ;
+      for (int i=0; i<8; i++) {
+         unsigned int m = boundmask(b, x, y + i, 8) ;
+         int s = 12 - 4 * (i & 3) ;
+         q[(i >> 2) * 2] &= ~(((~m >> 4) & 0xf) << s) ;
+         q[(i >> 2) * 2 + 1] &= ~((~m & 0xf) << s) ;
+      }
+      return (node *)find_leaf(q[0], q[1], q[2], q[3]) ;
+   }
+   long long h = 1LL << d ;
+   node *nw = clipnode(n->nw, d-1, x, y) ;
+   node *ne = clipnode(n->ne, d-1, x + h, y) ;
+   node *sw = clipnode(n->sw, d-1, x, y + h) ;
+   node *se = clipnode(n->se, d-1, x + h, y + h) ;
+   return find_node(nw, ne, sw, se) ;
+}
+/*
+ *   The result of a node on a bounded plane, given where it is.
+ */
+node *hlifealgo::boundres(node *n, int d, long long x, long long y) {
+   hlifebound *b = bound ;
+   long long size = 1LL << (d + 1) ;
+   if (n == zeronode(d))
+      return zeronode(d-1) ;
+   if ((b->wd == 0 || (x >= b->left && x + size - 1 <= b->right)) &&
+       (b->ht == 0 || (y >= b->top && y + size - 1 <= b->bottom)))
+      return save(getres(n, d)) ;
+   hlifeboundkey k = { n, d, x, y } ;
+   hlifeboundmap::iterator it = b->res.find(k) ;
+   if (it != b->res.end())
+      return it->second ;
+   if (poller->poll())
+      return zeronode(d-1) ;
+   node *r ;
+   d-- ;
+   if (is_node(n->nw))
+      r = boundrecurs(n->nw, n->ne, n->sw, n->se, d, x, y) ;
+   else
+      r = (node *)boundleaf(n, x, y, 1 << (ngens < 2 ? ngens : 2)) ;
+   if (poller->isInterrupted())
+      return zeronode(d) ;
+   b->res[k] = r ;
+   return r ;
+}
+/*
+ *   Just like dorecurs() and dorecurs_half() together, but keeping
+ *   track of where we are.
+ */
+node *hlifealgo::boundrecurs(node *n, node *ne, node *t, node *e, int depth,
+                             long long x, long long y) {
+   int sp = stackpos() ;
+   long long q = 1LL << depth, h = q >> 1 ;
+   node
+   *t00 = boundres(n, depth, x, y),
+   *t01 = boundres(find_node(n->ne, ne->nw, n->se, ne->sw), depth, x + q, y),
+   *t02 = boundres(ne, depth, x + 2 * q, y),
+   *t10 = boundres(find_node(n->sw, n->se, t->nw, t->ne), depth, x, y + q),
+   *t11 = boundres(find_node(n->se, ne->sw, t->ne, e->nw), depth,
+                   x + q, y + q),
+   *t12 = boundres(find_node(ne->sw, ne->se, e->nw, e->ne), depth,
+                   x + 2 * q, y + q),
+   *t20 = boundres(t, depth, x, y + 2 * q),
+   *t21 = boundres(find_node(t->ne, e->nw, t->se, e->sw), depth,
+                   x + q, y + 2 * q),
+   *t22 = boundres(e, depth, x + 2 * q, y + 2 * q) ;
+   if (ngens >= depth) {
+      node
+      *t33 = boundres(find_node(t00, t01, t10, t11), depth, x + h, y + h),
+      *t34 = boundres(find_node(t01, t02, t11, t12), depth,
+                      x + q + h, y + h),
+      *t43 = boundres(find_node(t10, t11, t20, t21), depth,
+                      x + h, y + q + h),
+      *t44 = boundres(find_node(t11, t12, t21, t22), depth,
+                      x + q + h, y + q + h) ;
+      n = find_node(t33, t34, t43, t44) ;
+   } else if (depth > 3) {
+      n = find_node(find_node(t00->se, t01->sw, t10->ne, t11->nw),
+                    find_node(t01->se, t02->sw, t11->ne, t12->nw),
+                    find_node(t10->se, t11->sw, t20->ne, t21->nw),
+                    find_node(t11->se, t12->sw, t21->ne, t22->nw)) ;
+   } else {
+      leaf *l[9] = { (leaf *)t00, (leaf *)t01, (leaf *)t02,
+                     (leaf *)t10, (leaf *)t11, (leaf *)t12,
+                     (leaf *)t20, (leaf *)t21, (leaf *)t22 } ;
+      n = find_node((node *)find_leaf(l[0]->se, l[1]->sw, l[3]->ne, l[4]->nw),
+                    (node *)find_leaf(l[1]->se, l[2]->sw, l[4]->ne, l[5]->nw),
+                    (node *)find_leaf(l[3]->se, l[4]->sw, l[6]->ne, l[7]->nw),
+                    (node *)find_leaf(l[4]->se, l[5]->sw, l[7]->ne, l[8]->nw)) ;
+   }
+   pop(sp) ;
+   return save(n) ;
+}
+/*
+ *   The center 8-square of a 16-square at x, y after gens generations,
+ *   clearing the cells outside the grid after each one.
+ */
+leaf *hlifealgo::boundleaf(node *n, long long x, long long y, int gens) {
+   unsigned int r[16], m[16] ;
+   leaf *q[4] = { (leaf *)(node *)n->nw, (leaf *)(node *)n->ne,
+                  (leaf *)(node *)n->sw, (leaf *)(node *)n->se } ;
+   int i, j ;
+   for (i=0; i<16; i++) {
+      m[i] = boundmask(bound, x, y + i, 16) ;
+      r[i] = ((leafrow(q[(i >> 3) * 2], i & 7) << 8) |
+              leafrow(q[(i >> 3) * 2 + 1], i & 7)) & m[i] ;
+   }
+   while (gens-- > 0) {
+      unsigned int t[16] ;
+      for (i=0; i<16; i++)
+         t[i] = 0 ;
+      for (i=1; i<15; i+=2)
+         for (j=1; j<15; j+=2) {
+            int s = 13 - j ;
+            int o = ruletable[(((r[i-1] >> s) & 0xf) << 12) |
+                              (((r[i] >> s) & 0xf) << 8) |
+                              (((r[i+1] >> s) & 0xf) << 4) |
+                              ((r[i+2] >> s) & 0xf)] ;
+            t[i] |= (((o >> 5) & 1) << (15 - j)) | (((o >> 4) & 1) << (14 - j)) ;
+            t[i+1] |= (((o >> 1) & 1) << (15 - j)) | ((o & 1) << (14 - j)) ;
+         }
+      for (i=0; i<16; i++)
+         r[i] = t[i] & m[i] ;
+   }
+   unsigned short c[4] = { 0, 0, 0, 0 } ;
+   for (i=0; i<4; i++) {
+      c[0] |= ((r[4+i] >> 8) & 0xf) << (12 - 4 * i) ;
+      c[1] |= ((r[4+i] >> 4) & 0xf) << (12 - 4 * i) ;
+      c[2] |= ((r[8+i] >> 8) & 0xf) << (12 - 4 * i) ;
+      c[3] |= ((r[8+i] >> 4) & 0xf) << (12 - 4 * i) ;
+   }
+   return find_leaf(c[0], c[1], c[2], c[3]) ;
+}
 const char *hlifealgo::readmacrocell(char *line) {
    int n=0 ;
    g_uintptr_t i=1, nw=0, ne=0, sw=0, se=0, indlen=0 ;
@@ -1528,13 +3884,12 @@ default:       return "Illegal character in readmacrocell." ;
             while (*pp > ' ') pp++ ;
             *pp = 0 ;
             
-            // AKT: need to check for B0-not-Smax rule
             err = hliferules.setrule(p, this);
             if (err)
                return err;
-            if (hliferules.alternate_rules)
-               return "B0-not-Smax rules are not allowed in HashLife.";
-            
+            setruleparity(0) ;
+            setleafrule() ;
+            setbounded() ;
             break ;
          case 'G':
             p = line + 2 ;
@@ -1660,10 +4015,10 @@ const char *hlifealgo::setrule(const char *s) {
    if (err) return err;
 
    clearcache() ;
-   
-   if (hliferules.alternate_rules)
-      return "B0-not-Smax rules are not allowed in HashLife.";
-      
+   setruleparity(0) ;
+   setleafrule() ;
+   setbounded() ;
+
    if (hliferules.isHexagonal())
       grid_type = HEX_GRID;
    else if (hliferules.isVonNeumann())
@@ -1673,6 +4028,39 @@ const char *hlifealgo::setrule(const char *s) {
       
    return 0 ;
 }
+/*
+ *   B0-not-Smax rules are emulated (as in QuickLife) with one table for
+ *   even generations and another for odd ones, so the background stays
+ *   empty; the state in odd generations is the complement of the real
+ *   one.  A leaf's two-generation result uses ruletable and then
+ *   ruletable2, and everything bigger is built from those, so all our
+ *   results hold for steps that start on a generation of the right
+ *   parity (ruleparity).  Starting on the other parity (which only odd
+ *   step sizes can lead to) means swapping the tables and recomputing
+ *   everything.
+ */
+void hlifealgo::setruleparity(int odd) {
+   char *t1 = hliferules.rule0, *t2 = hliferules.rule0 ;
+   if (hliferules.alternate_rules) {
+      t1 = odd ? hliferules.rule1 : hliferules.rule0 ;
+      t2 = odd ? hliferules.rule0 : hliferules.rule1 ;
+   }
+   if (t1 != ruletable || t2 != ruletable2)
+      clearcache() ;
+   ruletable = t1 ;
+   ruletable2 = t2 ;
+   ruleparity = odd ;
+}
+/*
+ *   See if the rule table could be done bit-parallel.
+ */
+void hlifealgo::setleafrule() {
+   leafbirth = leafsurvive = -1 ;
+   if (hliferules.alternate_rules)
+      return ;
+   if (!liferules::totalisticmasks(ruletable, leafbirth, leafsurvive))
+      leafbirth = leafsurvive = -1 ;
+}
 void hlifealgo::unpack8x8(unsigned short nw, unsigned short ne,
                           unsigned short sw, unsigned short se,
                           unsigned int *top, unsigned int *bot) {
@@ -1692,12 +4080,11 @@ g_uintptr_t hlifealgo::writecell(std::ostream &os, node *root, int depth) {
    if (root == zeronode(depth))
       return 0 ;
    if (depth == 2) {
-      if (root->nw != 0)
-         return (g_uintptr_t)(root->nw) ;
+      if (scratch(root->nw) != 0)
+         return scratch(root->nw) ;
    } else {
       if (marked2(root))
-         return (g_uintptr_t)(root->next) ;
-      unhash_node(root) ;
+         return scratch(root->next) ;
       mark2(root) ;
    }
    if (depth == 2) {
@@ -1705,7 +4092,7 @@ g_uintptr_t hlifealgo::writecell(std::ostream &os, node *root, int depth) {
       unsigned int top, bot ;
       leaf *n = (leaf *)root ;
       thiscell = ++cellcounter ;
-      root->nw = (node *)thiscell ;
+      setscratch(root->nw, thiscell) ;
       unpack8x8(n->nw, n->ne, n->sw, n->se, &top, &bot) ;
       for (j=7; (top | bot) && j>=0; j--) {
          int bits = (top >> 24) ;
@@ -1725,7 +4112,7 @@ g_uintptr_t hlifealgo::writecell(std::ostream &os, node *root, int depth) {
       g_uintptr_t sw = writecell(os, root->sw, depth-1) ;
       g_uintptr_t se = writecell(os, root->se, depth-1) ;
       thiscell = ++cellcounter ;
-      root->next = (node *)thiscell ;
+      setscratch(root->next, thiscell) ;
       os << depth+1 << ' ' << nw << ' ' << ne << ' ' << sw << ' ' << se << '\n';
    }
    return thiscell ;
@@ -1740,12 +4127,11 @@ g_uintptr_t hlifealgo::writecell_2p1(node *root, int depth) {
    if (root == zeronode(depth))
       return 0 ;
    if (depth == 2) {
-      if (root->nw != 0)
-         return (g_uintptr_t)(root->nw) ;
+      if (scratch(root->nw) != 0)
+         return scratch(root->nw) ;
    } else {
       if (marked2(root))
-         return (g_uintptr_t)(root->next) ;
-      unhash_node(root) ;
+         return scratch(root->next) ;
       mark2(root) ;
    }
    if (depth == 2) {
@@ -1753,7 +4139,7 @@ g_uintptr_t hlifealgo::writecell_2p1(node *root, int depth) {
       // note:  we *must* not abort this prescan
       if ((cellcounter & 4095) == 0)
          lifeabortprogress(0, "Scanning tree") ;
-      root->nw = (node *)thiscell ;
+      setscratch(root->nw, thiscell) ;
    } else {
       writecell_2p1(root->nw, depth-1) ;
       writecell_2p1(root->ne, depth-1) ;
@@ -1763,7 +4149,7 @@ g_uintptr_t hlifealgo::writecell_2p1(node *root, int depth) {
       // note:  we *must* not abort this prescan
       if ((cellcounter & 4095) == 0)
          lifeabortprogress(0, "Scanning tree") ;
-      root->next = (node *)thiscell ;
+      setscratch(root->next, thiscell) ;
    }
    return thiscell ;
 }
@@ -1777,8 +4163,8 @@ g_uintptr_t hlifealgo::writecell_2p2(std::ostream &os, node *root, int depth) {
    if (root == zeronode(depth))
       return 0 ;
    if (depth == 2) {
-      if (cellcounter + 1 != (g_uintptr_t)(root->nw))
-         return (g_uintptr_t)(root->nw) ;
+      if (cellcounter + 1 != scratch(root->nw))
+         return scratch(root->nw) ;
       thiscell = ++cellcounter ;
       if ((cellcounter & 4095) == 0) {
          std::streampos siz = os.tellp();
@@ -1788,7 +4174,7 @@ g_uintptr_t hlifealgo::writecell_2p2(std::ostream &os, node *root, int depth) {
       int i, j ;
       unsigned int top, bot ;
       leaf *n = (leaf *)root ;
-      root->nw = (node *)thiscell ;
+      setscratch(root->nw, thiscell) ;
       unpack8x8(n->nw, n->ne, n->sw, n->se, &top, &bot) ;
       for (j=7; (top | bot) && j>=0; j--) {
          int bits = (top >> 24) ;
@@ -1803,16 +4189,16 @@ g_uintptr_t hlifealgo::writecell_2p2(std::ostream &os, node *root, int depth) {
       }
       os << '\n' ;
    } else {
-      if (cellcounter + 1 > (g_uintptr_t)(root->next) || isaborted())
-         return (g_uintptr_t)(root->next) ;
+      if (cellcounter + 1 > scratch(root->next) || isaborted())
+         return scratch(root->next) ;
       g_uintptr_t nw = writecell_2p2(os, root->nw, depth-1) ;
       g_uintptr_t ne = writecell_2p2(os, root->ne, depth-1) ;
       g_uintptr_t sw = writecell_2p2(os, root->sw, depth-1) ;
       g_uintptr_t se = writecell_2p2(os, root->se, depth-1) ;
       if (!isaborted() &&
-          cellcounter + 1 != (g_uintptr_t)(root->next)) { // this should never happen
+          cellcounter + 1 != scratch(root->next)) { // this should never happen
          lifefatal("Internal in writecell_2p2") ;
-         return (g_uintptr_t)(root->next) ;
+         return scratch(root->next) ;
       }
       thiscell = ++cellcounter ;
       if ((cellcounter & 4095) == 0) {
@@ -1820,7 +4206,7 @@ g_uintptr_t hlifealgo::writecell_2p2(std::ostream &os, node *root, int depth) {
          sprintf(progressmsg, "File size: %.2f MB", double(siz) / 1048576.0) ;
          lifeabortprogress(thiscell/(double)writecells, progressmsg) ;
       }
-      root->next = (node *)thiscell ;
+      setscratch(root->next, thiscell) ;
       os << depth+1 << ' ' << nw << ' ' << ne << ' ' << sw << ' ' << se << '\n';
    }
    return thiscell ;
@@ -1829,6 +4215,7 @@ g_uintptr_t hlifealgo::writecell_2p2(std::ostream &os, node *root, int depth) {
 #define STR2(arg) #arg
 const char *hlifealgo::writeNativeFormat(std::ostream &os, char *comments) {
    int depth = node_depth(root) ;
+   gcabort() ;
    os << "[M2] (golly " STRINGIFY(VERSION) ")\n" ;
 
    // AKT: always write out explicit rule
@@ -1893,7 +4280,7 @@ const char *hlifealgo::writeNativeFormat(std::ostream &os, char *comments) {
      for (int i=0; i<timeline.framecount; i++) {
        node *frame = (node*)timeline.frames[i] ;
        writecell_2p2(os, frame, depths[i]) ;
-       os << "#FRAME " << i << ' ' << (g_uintptr_t)frame->next << '\n' ;
+       os << "#FRAME " << i << ' ' << scratch(frame->next) << '\n' ;
      }
    }
    writecell_2p2(os, root, depth) ;
@@ -1901,10 +4288,10 @@ const char *hlifealgo::writeNativeFormat(std::ostream &os, char *comments) {
    if (framestosave) {
      for (int i=0; i<timeline.framecount; i++) {
        node *frame = (node*)timeline.frames[i] ;
-       aftercalcpop2(frame, depths[i], 0) ;
+       aftercalcpop2(frame, depths[i]) ;
      }
    }
-   aftercalcpop2(root, depth, 0) ;
+   aftercalcpop2(root, depth) ;
    inGC = 0 ;
    return 0 ;
 }
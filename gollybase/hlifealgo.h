@@ -25,6 +25,8 @@ Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
 #define HLIFEALGO_H
 #include "lifealgo.h"
 #include "liferules.h"
+#include <deque>
+#include <string>
 /*
  *   Into instances of this node structure is where almost all of the
  *   memory allocated by this program goes.  Thus, it is imperative we
@@ -106,16 +108,57 @@ Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
  *
  *   Where do we cache the results?  Well, we cache the results in the
  *   same node structure we are using to store the pointers to the
- *   smaller squares themselves.  And since we're hashing them all
- *   together, we want a next pointer for the hash chain.  Put all of
- *   this together, and you get the following structure for the 16-squares
- *   and larger:
+ *   smaller squares themselves.  We also want a next pointer, for the
+ *   free list and as scratch space for the routines that walk the tree.
+ *   Put all of this together, and you get the following structure for
+ *   the 16-squares and larger:
  */
+#ifndef HLIFECOMPACT
 struct node {
-   node *next ;              /* hash link */
+   node *next ;              /* free list link; scratch */
    node *nw, *ne, *sw, *se ; /* constant; nw != 0 means nonleaf */
    node *res ;               /* cache */
 } ;
+typedef node *nodefield ;
+#else
+/*
+ *   If HLIFECOMPACT is defined, the pointers in a node are replaced by
+ *   32-bit references, which halves the size of a node on a 64-bit
+ *   machine.  Nodes then live in slabs of 2**HSLABBITS bytes, aligned
+ *   on that size, and the second word of every slab holds its number.
+ *   So going from a pointer to a reference is a mask and a load, and
+ *   back again is a table lookup and an add.  A reference of zero is a
+ *   null pointer (slab zero is never used).  A noderef converts to and
+ *   from a node pointer, so most of the code doesn't need to know.
+ */
+#define HSLABBITS (20)
+#define HSLABMAX (1 << (32 - HSLABBITS + 2))
+struct node ;
+extern char *hlifeslabs[HSLABMAX] ;
+inline node *hlifedecode(unsigned int i) {
+   return (node *)(hlifeslabs[i >> (HSLABBITS - 2)] +
+                   ((i & ((1 << (HSLABBITS - 2)) - 1)) << 2)) ;
+}
+inline unsigned int hlifeencode(const node *p) {
+   if (p == 0)
+      return 0 ;
+   g_uintptr_t base = (g_uintptr_t)p & ~(g_uintptr_t)((1 << HSLABBITS) - 1) ;
+   return (((unsigned int *)base)[1] << (HSLABBITS - 2)) |
+          (unsigned int)(((g_uintptr_t)p - base) >> 2) ;
+}
+struct noderef {
+   unsigned int i ;
+   operator node *() const { return hlifedecode(i) ; }
+   node *operator->() const { return hlifedecode(i) ; }
+   noderef &operator=(const node *p) { i = hlifeencode(p) ; return *this ; }
+} ;
+struct node {
+   noderef next ;            /* free list link; scratch */
+   noderef nw, ne, sw, se ;  /* constant; nw != 0 means nonleaf */
+   noderef res ;             /* cache */
+} ;
+typedef noderef nodefield ;
+#endif
 /*
  *   For the 8-squares, we do not have `children', we have actual data
  *   values.  We still break up the 8-square into 4-squares, but the
@@ -139,8 +182,9 @@ struct node {
  *   left (or northwest) bit, and bit 0x1000 is the upper right bit, and
  *   so on.
  */
+#ifndef HLIFECOMPACT
 struct leaf {
-   node *next ;              /* hash link */
+   node *next ;              /* free list link; scratch */
    node *isnode ;            /* must always be zero for leaves */
    unsigned short nw, ne, sw, se ;  /* constant */
    unsigned short res1, res2 ;      /* constant */
@@ -151,6 +195,33 @@ struct leaf {
  *   returns a zero value.
  */
 #define is_node(n) (((node *)(n))->nw)
+#else
+/*
+ *   In the compact build the results of a leaf are only computed when
+ *   someone first asks for them; until then leafpop is LEAFPENDING.
+ */
+#define LEAFPENDING (0xffff)
+struct leaf {
+   noderef next ;            /* free list link; scratch */
+   noderef isnode ;          /* must always be zero for leaves */
+   unsigned short nw, ne, sw, se ;  /* constant */
+   unsigned short res1, res2 ;      /* constant once computed */
+   unsigned short leafpop ;         /* how many set bits */
+} ;
+#define is_node(n) (((node *)(n))->nw.i)
+#endif
+/*
+ *   Per-thread state and the worker pool for multithreaded stepping;
+ *   these are only used inside hlifealgo.cpp.
+ */
+struct hlifeworker ;
+struct hlifepool ;
+struct hlifebucket ;
+struct hlifegc ;
+struct hlifespill ;
+struct hlifebound ;
+struct hlifepopmemo ;
+struct hlifeedgememo ;
 /**
  *   Our hlifealgo class.
  */
@@ -174,6 +245,13 @@ public:
    virtual int hyperCapable() { return 1 ; }
    virtual void setMaxMemory(int m) ;
    virtual int getMaxMemory() { return (int)(maxmem >> 20) ; }
+   virtual void setThreads(int n) ;
+   virtual void setIncrementalGC(int on) ;
+   virtual double getMaxGCPause() { return gcmaxpause ; }
+   virtual const char *setSpillDir(const char *dir) ;
+   virtual void setStepCaches(int n) ;
+   virtual void setRuleCaches(int n) ;
+   virtual bool handlesBoundedGrid() { return bound != 0 ; }
    virtual const char *setrule(const char *s) ;
    virtual const char *getrule() { return hliferules.getrule() ; }
    virtual void step() ;
@@ -215,8 +293,15 @@ private:
  */
    node **stack ;
    int stacksize ;
-   g_uintptr_t hashpop, hashlimit, hashprime ;
-   node **hashtab ;
+   g_uintptr_t hashpop, hashlimit, hashmask, hashslack ;
+   hlifebucket *hashtab ;
+   void *hashmem ;
+   int hashshift ;
+   /* while the hash is growing, the table we're moving away from */
+   hlifebucket *oldtab ;
+   void *oldmem ;
+   g_uintptr_t oldmask, oldcursor ;
+   int oldshift ;
    int halvesdone ;
    int gsp ;
    g_uintptr_t alloced, maxmem ;
@@ -224,7 +309,9 @@ private:
    int okaytogc ;
    g_uintptr_t totalthings ;
    node *nodeblocks ;
-   char *ruletable ;
+   char *ruletable, *ruletable2 ; // for the two generations of a leaf
+   int ruleparity ;               // see setruleparity()
+   int leafbirth, leafsurvive ; // see leafnext() in hlifealgo.cpp
    bigint population ;
    bigint setincrement ;
    bigint pow2step ; // greatest power of two in increment
@@ -244,21 +331,90 @@ private:
    int cacheinvalid ;
    g_uintptr_t cellcounter ; // used when writing
    g_uintptr_t writecells ; // how many to write
+   std::deque<bigint> popcache ; // calcpop's bigints, for the big nodes
+   vector<G_INT64> popsmall ; // smallpop's sums for the nodes it marked
+   vector<hlifepopmemo> popmemo ; // see smallpop() in hlifealgo.cpp
+   vector<hlifeedgememo> edgememo ; // see nodeedges() in hlifealgo.cpp
    int gccount ; // how many gcs total this pattern
    int gcstep ; // how many gcs this step
+   double gcmaxpause ; // longest time any gc held up the calculation
+/*
+ *   Incremental collection (see gcstart() in hlifealgo.cpp).  A cycle
+ *   marks and then sweeps a few nodes each time we add one to the hash,
+ *   evicting the results nobody has asked for since the last cycle.
+ */
+   int gcincremental ; // collect incrementally rather than all at once
+   int gctrack ; // incremental and not multithreaded right now
+   int gcphase ; // GCIDLE, GCMARK or GCSWEEP
+   g_uintptr_t gcepoch ; // number of the current (or last) cycle
+   g_uintptr_t gccursor ; // next bucket to sweep
+   g_uintptr_t gcpace ; // units of work per new node
+   g_uintptr_t gcfreed ; // nodes freed this cycle
+   vector<node *> gcgray ; // marked but not yet scanned
+   vector<node *> gcmoved ; // scratch for gcrehash()
    static char statusline[] ;
+/*
+ *   When we have more than one thread, the top of the recursion hands
+ *   independent subresults to a pool of workers.  While that is going
+ *   on parallel is set, and every thread uses its own root stack and
+ *   free list chunk (see hlifepool in hlifealgo.cpp).
+ */
+   friend struct hlifepool ;
+   hlifepool *pool ;
+   int parallel ;
+   void startthreads() ;
+   void stopthreads() ;
+   void beginparallel() ;
+   void endparallel() ;
+   int stackpos() ;
+   node *find_node_par(node *nw, node *ne, node *sw, node *se) ;
+   leaf *find_leaf_par(unsigned short nw, unsigned short ne,
+                       unsigned short sw, unsigned short se) ;
+   node *dorecurs_par(node *n, node *ne, node *t, node *e, int depth,
+                      int half) ;
+   node *newnode_par() ;
+   void allocblock() ;
+/*
+ *   If set, the node blocks live in a memory-mapped file (see
+ *   hlifespill in hlifealgo.cpp), and memused() counts what has to
+ *   stay in memory rather than all we've allocated.
+ */
+   hlifespill *spill ;
+   g_uintptr_t memused(g_uintptr_t morenodes) ;
 //
    void leafres(leaf *n) ;
+#ifndef HLIFECOMPACT
+   void newleafres(leaf *n) { leafres(n) ; }
+   unsigned short leafres1(leaf *n) { return n->res1 ; }
+   unsigned short leafres2(leaf *n) { return n->res2 ; }
+   unsigned short leafpopof(leaf *n) { return n->leafpop ; }
+#else
+   void newleafres(leaf *n) { n->leafpop = LEAFPENDING ; }
+   void leafready(volatile leaf *n) {
+      if (n->leafpop == LEAFPENDING)
+         leafres((leaf *)n) ;
+   }
+   unsigned short leafres1(volatile leaf *n) { leafready(n) ; return n->res1 ; }
+   unsigned short leafres2(volatile leaf *n) { leafready(n) ; return n->res2 ; }
+   unsigned short leafpopof(volatile leaf *n) {
+      leafready(n) ;
+      return n->leafpop ;
+   }
+#endif
    void resize() ;
    node *find_node(node *nw, node *ne, node *sw, node *se) ;
-   void unhash_node(node *n) ;
-   void rehash_node(node *n) ;
+   void hashinsert(node *n, int shared) ;
+   void addedone() ;
+   void addedone_par() ;
+   void migrate(int n) ;
+   void finishresize() ;
    leaf *find_leaf(unsigned short nw, unsigned short ne,
                    unsigned short sw, unsigned short se) ;
    node *getres(node *n, int depth) ;
    node *dorecurs(node *n, node *ne, node *t, node *e, int depth) ;
    node *dorecurs_half(node *n, node *ne, node *t, node *e, int depth) ;
    leaf *dorecurs_leaf(leaf *n, leaf *ne, leaf *t, leaf *e) ;
+   leaf *leafstep(leaf *n, leaf *ne, leaf *t, leaf *e, int gens) ;
    leaf *dorecurs_leaf_half(leaf *n, leaf *ne, leaf *t, leaf *e) ;
    leaf *dorecurs_leaf_quarter(leaf *n, leaf *ne, leaf *t, leaf *e) ;
    node *newnode() ;
@@ -275,7 +431,10 @@ private:
    node *hashpattern(node *root, int depth) ;
    node *popzeros(node *n) ;
    const bigint &calcpop(node *root, int depth) ;
-   void aftercalcpop2(node *root, int depth, int cleanbigints) ;
+   G_INT64 smallpop(node *root, int depth) ;
+   int nodeedges(node *root, int depth, long long *e) ;
+   long long nodeedge(node *root, int depth, int side, long long limit) ;
+   void aftercalcpop2(node *root, int depth) ;
    void calcPopulation(node *root) ;
    node *save(node *n) ;
    void pop(int n) ;
@@ -283,7 +442,61 @@ private:
    void clearcache() ;
    void gc_mark(node *root, int invalidate) ;
    void do_gc(int invalidate) ;
+   g_uintptr_t gc_par(vector<node *> &roots, int invalidate, int nthreads) ;
+   void gc_par_mark(hlifegc *g, int t) ;
+   void gc_par_sweep(hlifegc *g, int t) ;
+   void gcroom() ;
+   void gcstart() ;
+   void gcshade(node *n) ;
+   void gcscan(node *n) ;
+   void gcsweepbucket(g_uintptr_t h) ;
+   void gcrehash(g_uintptr_t h) ;
+   void gcfree(node *n) ;
+   void gcwork(g_uintptr_t n) ;
+   void gcdone() ;
+   void gcfinish() ;
+   void gcabort() ;
+   void gcpaused(double since) ;
    void clearcache(node *n, int depth, int clearto) ;
+/*
+ *   Results put aside for other step sizes and other rules (see
+ *   keptswap() and keptrule()).
+ */
+   int stepcaches, rulecaches ;
+   vector<int> keptgens ;
+   vector<std::string> keptrules ;
+   vector<vector<node *> > keptres ;
+   vector<node *> keeping ;
+   std::string rulekey ;
+   g_uintptr_t keptbytes ;
+   void keptswap(int oldngens) ;
+   void keptrule() ;
+   void keptrestore() ;
+   void keptlimit() ;
+   void keptaccount() ;
+   void keptmark(int invalidate) ;
+   int gckept() ;
+/*
+ *   A torus or bounded plane we step ourselves (see hlifebound in
+ *   hlifealgo.cpp), or null; boundextra is how many doublings of the
+ *   step we do by stepping repeatedly.
+ */
+   hlifebound *bound ;
+   int boundextra ;
+   void setbounded() ;
+   node *boundedstep() ;
+   node *boundstep(node *n, int extra) ;
+   node *torusstep(node *n) ;
+   node *planestep(node *n) ;
+   node *tilenode(int depth, long long x, long long y) ;
+   leaf *leafat(long long x, long long y) ;
+   unsigned int rowat(long long x, long long y) ;
+   unsigned int tilerow(long long x, long long y) ;
+   node *clipnode(node *n, int depth, long long x, long long y) ;
+   node *boundres(node *n, int depth, long long x, long long y) ;
+   node *boundrecurs(node *n, node *ne, node *t, node *e, int depth,
+                     long long x, long long y) ;
+   leaf *boundleaf(node *n, long long x, long long y, int gens) ;
    void new_ngens(int newval) ;
    int log2(unsigned int n) ;
    node *runpattern() ;
@@ -295,6 +508,8 @@ private:
    g_uintptr_t writecell(std::ostream &os, node *root, int depth) ;
    g_uintptr_t writecell_2p1(node *root, int depth) ;
    g_uintptr_t writecell_2p2(std::ostream &os, node *root, int depth) ;
+   void setleafrule() ;
+   void setruleparity(int odd) ;
    void unpack8x8(unsigned short nw, unsigned short ne,
                   unsigned short sw, unsigned short se,
                   unsigned int *top, unsigned int *bot) ;
@@ -446,6 +446,15 @@ void hlifealgo::findedges(bigint *ptop, bigint *pleft, bigint *pbottom, bigint *
       *pright = 0 ;
       return ;
    }
+   long long e[4] ;
+   if (nodeedges(root, currdepth, e)) {
+      long long o = 1LL << currdepth ; // rows count down and y is one off
+      *pleft = bigint((G_INT64)(e[0] - o)) ;
+      *ptop = bigint((G_INT64)(e[1] - o + 1)) ;
+      *pright = bigint((G_INT64)(e[2] - o)) ;
+      *pbottom = bigint((G_INT64)(e[3] - o + 1)) ;
+      return ;
+   }
    vector<node *> top, left, bottom, right ;
    top.push_back(root) ;
    left.push_back(root) ;
@@ -629,6 +638,8 @@ void hlifealgo::fit(viewport &view, int force) {
       view.setmag(MAX_MAG) ;
       return ;
    }
+   long long e[4] ;
+   int exact = nodeedges(root, currdepth, e) ;
    vector<node *> top, left, bottom, right ;
    top.push_back(root) ;
    left.push_back(root) ;
@@ -637,13 +648,40 @@ void hlifealgo::fit(viewport &view, int force) {
    int topbm = 0, bottombm = 0, rightbm = 0, leftbm = 0 ;
    while (currdepth >= 0) {
       currdepth-- ;
-      if (currdepth == 1) { // we have leaf nodes; turn them into bitmasks
+      if (!exact && currdepth == 1) { // leaf nodes; turn them into bitmasks
          topbm = getbitsfromleaves(top) & 0xff ;
          bottombm = getbitsfromleaves(bottom) & 0xff ;
          leftbm = getbitsfromleaves(left) >> 8 ;
          rightbm = getbitsfromleaves(right) >> 8 ;
       }
-      if (currdepth <= 1) {
+      if (exact) {
+         // with the exact edges in hand, the outer half of the last
+         // block on each side has something in it just when the edge
+         // does
+         int b = currdepth + 1 ;
+         ymax += ymax ;
+         if ((e[1] >> b) & 1) {
+            ymax.add_smallint(-2) ;
+            ysize-- ;
+         }
+         ymin += ymin ;
+         if (((e[3] >> b) & 1) == 0) {
+            ymin.add_smallint(2) ;
+            ysize-- ;
+         }
+         xmax += xmax ;
+         if (((e[2] >> b) & 1) == 0) {
+            xmax.add_smallint(-2) ;
+            xsize-- ;
+         }
+         xmin += xmin ;
+         if ((e[0] >> b) & 1) {
+            xmin.add_smallint(2) ;
+            xsize-- ;
+         }
+         xsize *= 2 ;
+         ysize *= 2 ;
+      } else if (currdepth <= 1) {
          int sz = 1 << (currdepth + 2) ;
          int maskhi = (1 << sz) - (1 << (sz >> 1)) ;
          int masklo = (1 << (sz >> 1)) - 1 ;
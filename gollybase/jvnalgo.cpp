@@ -265,6 +265,10 @@ state jvnalgo::slowcalc(state, state n, state, state w, state c, state e,
    	return slowcalc_Hutton32(c,n,s,e,w);
 }
 
+void jvnalgo::slowcalc4(const state *b, state *r) {
+   ghashslowcalc4(this, b, r) ;
+}
+
 // XPM data for the 31 7x7 icons used in JvN algo
 static const char* jvn7x7[] = {
 // width height ncolors chars_per_pixel
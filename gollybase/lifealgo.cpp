@@ -757,7 +757,8 @@ void lifealgo::JoinEdges(int pt, int pl, int pb, int pr)    // pattern edges
 bool lifealgo::CreateBorderCells()
 {
     // no need to do anything if there is no pattern or if the grid is a bounded plane
-    if (isEmpty() || boundedplane) return true;
+    // (or if step() does the wrapping itself)
+    if (handlesBoundedGrid() || isEmpty() || boundedplane) return true;
     
     bigint top, left, bottom, right;
     findedges(&top, &left, &bottom, &right);
@@ -835,8 +836,8 @@ void lifealgo::ClearRect(int top, int left, int bottom, int right)
 
 bool lifealgo::DeleteBorderCells()
 {
-    // no need to do anything if there is no pattern
-    if (isEmpty()) return true;
+    // no need to do anything if there is no pattern or if step() did the clipping
+    if (handlesBoundedGrid() || isEmpty()) return true;
     
     // need to find pattern edges because pattern may have expanded beyond grid
     // (typically by 2 cells, but could be more if rule allows births in empty space)
@@ -66,6 +66,7 @@ class lifealgo {
 public:
    lifealgo() : generation(0), increment(0), timeline(), grid_type(SQUARE_GRID)
       {  poller = &default_poller ;
+         numthreads = 1 ;
          gridwd = gridht = 0 ;         // default is an unbounded universe
       }
    virtual ~lifealgo() ;
@@ -87,6 +88,29 @@ public:
    virtual int hyperCapable() = 0 ;
    virtual void setMaxMemory(int m) = 0 ;          // never alloc more than this
    virtual int getMaxMemory() = 0 ;
+   // how many threads step() may use; algorithms that cannot use more
+   // than one simply ignore this
+   virtual void setThreads(int n) { numthreads = (n < 1) ? 1 : n ; }
+   int getThreads() { return numthreads ; }
+   // reclaim memory a little at a time as we go rather than all at once
+   // when it runs out, and the longest time (in seconds) a collection
+   // has held up a step; only hashlife does either
+   virtual void setIncrementalGC(int) {}
+   virtual double getMaxGCPause() { return 0 ; }
+   // keep the bulk of the universe in a file in the given directory,
+   // which the system can page out to disk, so only the rest counts
+   // against the memory limit; returns err msg; only hashlife does this
+   virtual const char *setSpillDir(const char *) { return 0 ; }
+   // when the step size changes, put the cached results for the old
+   // one aside (for up to n step sizes) so changing back is quick
+   virtual void setStepCaches(int) {}
+   // likewise when the rule changes, for up to n other rules
+   virtual void setRuleCaches(int) {}
+   // how many times the cache of rule results in front of the
+   // transition function was consulted, and how many of those it
+   // answered; only the multistate hashing algorithms have one
+   virtual double getCalcCacheLookups() { return 0 ; }
+   virtual double getCalcCacheHits() { return 0 ; }
    virtual const char *setrule(const char *) = 0 ; // new rules; returns err msg
    virtual const char *getrule() = 0 ;             // get current rule set
    virtual void step() = 0 ;                       // do inc gens
@@ -146,6 +170,9 @@ public:
    // the above routines can be called around step() to create the
    // illusion of a bounded universe (note that increment must be 1);
    // they return false if the pattern exceeds the editing limits
+   virtual bool handlesBoundedGrid() { return false ; }
+   // true if step() does the current topology itself, with any
+   // increment; the two routines above then do nothing
    
    enum TGridType { SQUARE_GRID, TRI_GRID, HEX_GRID, VN_GRID } ;
    TGridType getgridtype() const { return grid_type ; }
@@ -154,6 +181,7 @@ protected:
    lifepoll *poller ;
    static int verbose ;
    int maxCellStates ; // keep up to date; setcell depends on it
+   int numthreads ;
    bigint generation ;
    bigint increment ;
    timeline_t timeline ;
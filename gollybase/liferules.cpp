@@ -757,6 +757,23 @@ const char *liferules::setrule(const char *rulestring, lifealgo *algo) {
 
    // check for colon
    colonpos = strchr(r, ':') ;
+
+   // if we've set this rule before then just copy its tables back
+   int keylen = colonpos ? (int)(colonpos - r) : (int)strlen(r) ;
+   if (findCachedRule(rulestring, keylen)) {
+      if (colonpos) {
+         const char* err = algo->setgridsize(colonpos) ;
+         if (err) return err ;
+      } else {
+         algo->gridwd = 0 ;
+         algo->gridht = 0 ;
+      }
+      if (algo->gridwd > 0 || algo->gridht > 0) {
+         strcat(canonrule, algo->canonicalsuffix()) ;
+      }
+      return 0 ;
+   }
+
    if (colonpos) {
       // only process up to the colon
       end = colonpos ;
@@ -1133,15 +1150,81 @@ const char *liferules::setrule(const char *rulestring, lifealgo *algo) {
    // save the rule
    saveRule() ;
 
+   // remember it in case it gets set again
+   cacheRule(rulestring, keylen) ;
+
    // exit with success
    return 0 ;
 }
 
+/*
+ *   The last few rules set, so that setting one again (loading a pattern
+ *   sets B3/S23 before the pattern's own rule, for instance) just copies
+ *   the tables back rather than building the 4x4 maps again.  They are
+ *   keyed by the rule string up to any colon and kept without the bounded
+ *   grid suffix; all the pointers in a liferules point at static data, so
+ *   a plain copy is enough.
+ */
+const int RULECACHESIZE = 8 ;
+static liferules *rulecache[RULECACHESIZE] ;
+static char rulecachekey[RULECACHESIZE][MAXRULESIZE + 1] ;
+static int rulecachenext = 0 ;
+
+bool liferules::findCachedRule(const char *key, int keylen) {
+   for (int i = 0 ; i < RULECACHESIZE ; i++) {
+      if (rulecache[i] && strncmp(rulecachekey[i], key, keylen) == 0 &&
+          rulecachekey[i][keylen] == 0) {
+         *this = *rulecache[i] ;
+         return true ;
+      }
+   }
+   return false ;
+}
+
+void liferules::cacheRule(const char *key, int keylen) {
+   liferules *&slot = rulecache[rulecachenext] ;
+   if (slot == 0)
+      slot = new liferules() ;
+   *slot = *this ;
+   char *suffix = strchr(slot->canonrule, ':') ;
+   if (suffix)
+      *suffix = 0 ;
+   strncpy(rulecachekey[rulecachenext], key, keylen) ;
+   rulecachekey[rulecachenext][keylen] = 0 ;
+   rulecachenext = (rulecachenext + 1) % RULECACHESIZE ;
+}
+
 const char* liferules::getrule() {
    return canonrule ;
 }
 
 // B3/S23 -> (1 << 3) + (1 << (9 + 2)) + (1 << (9 + 3)) = 0x1808
+/*
+ *   Try every 3x3 neighborhood in the upper left of a 4x4 and see if
+ *   the result only depends on the center cell and its neighbor count.
+ */
+bool liferules::totalisticmasks(const char *table, int &birth,
+                                int &survive) {
+   int rule[2] = { 0, 0 }, seen[2] = { 0, 0 } ;
+   for (int i=0; i<ALL3X3; i++) {
+      int alive = (i >> 4) & 1, count = 0 ;
+      for (int n=i & 0x1ef; n; n &= n - 1)
+         count++ ;
+      int bit = 1 << count ;
+      int on = (table[((i & 0x1c0) << 7) | ((i & 0x38) << 6) |
+                      ((i & 7) << 5)] >> 5) & 1 ;
+      if (!(seen[alive] & bit)) {
+         seen[alive] |= bit ;
+         if (on)
+            rule[alive] |= bit ;
+      } else if (((rule[alive] & bit) != 0) != on) {
+         return false ;
+      }
+   }
+   birth = rule[0] ;
+   survive = rule[1] ;
+   return true ;
+}
 bool liferules::isRegularLife() {
    return (neighbormask == MOORE && totalistic && rulebits == 0x1808 && wolfram < 0) ;
 }
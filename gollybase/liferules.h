@@ -66,6 +66,11 @@ public:
    bool isHexagonal() const { return neighbormask == HEXAGONAL ; }
    bool isVonNeumann() const { return neighbormask == VON_NEUMANN ; }
    bool isWolfram() const { return wolfram >= 0 ; }
+   // if a 4x4 rule table depends only on a cell and how many of its
+   // eight neighbors are on, set bit n of birth and survive if a cell
+   // with n neighbors is born or survives and return true (see
+   // totalisticnext() below)
+   static bool totalisticmasks(const char *table, int &birth, int &survive) ;
 
 private:
    char canonrule[MAXRULESIZE] ;      // canonical version of valid rule passed into setrule
@@ -103,5 +108,44 @@ private:
    void removeChar(char *string, char skip) ;
    bool lettersValid(const char *part) ;
    int addLetters(int count, int p) ;
+   bool findCachedRule(const char *key, int keylen) ;
+   void cacheRule(const char *key, int keylen) ;
 } ;
+/*
+ *   Rules that totalisticmasks() accepts can be computed for a whole
+ *   word of cells at once with a few logical operations instead of the
+ *   table.  This takes the cells, the sum (as low and high bits) of the
+ *   three cells above and below each cell, and of the two beside it,
+ *   all lined up with the cells, and returns the next generation.  T is
+ *   any integer or vector type.
+ */
+template <class T> inline T totalisticnext(T x, T al, T ah, T bl, T bh,
+                                           T cl, T ch, int birth,
+                                           int survive) {
+   T s0 = al ^ bl, k = al & bl ;
+   T s1 = ah ^ bh ^ k, s2 = (ah & bh) | (k & (ah ^ bh)) ;
+   T c0 = s0 ^ cl ;
+   k = s0 & cl ;
+   T c1 = s1 ^ ch ^ k ;
+   k = (s1 & ch) | (k & (s1 ^ ch)) ;
+   T c2 = s2 ^ k, c3 = s2 & k ;
+   if (birth == 0x8 && survive == 0xc) // B3/S23
+      return c1 & ~c2 & ~c3 & (c0 | x) ;
+   // the count is at most 8, so c3 is only set when the rest are clear
+   T lo[4] = { ~(c1 | c0), ~c1 & c0, c1 & ~c0, c1 & c0 } ;
+   T hi[3] = { ~(c2 | c3), c2, c3 } ;
+   T r = x ^ x, nx = ~x ;
+   for (int i=0; i<=8; i++) {
+      int b = (birth >> i) & 1, sv = (survive >> i) & 1 ;
+      if (b | sv) {
+         T m = hi[i >> 2] & lo[i & 3] ;
+         if (!b)
+            m = m & x ;
+         else if (!sv)
+            m = m & nx ;
+         r = r | m ;
+      }
+   }
+   return r ;
+}
 #endif
@@ -58,3 +58,21 @@ Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
    #define G_MAX UINT_MAX
    #undef GOLLY64BIT
 #endif
+/*
+ *   The multithreaded hashlife code publishes new nodes into hash
+ *   buckets with a single compare-and-swap on the bucket head, so
+ *   readers never need a lock.  This returns nonzero if *p was o and
+ *   has been replaced with n.
+ */
+#if defined(_MSC_VER)
+   #include <intrin.h>
+   #define g_cas_ptr(p, o, n) \
+      (_InterlockedCompareExchangePointer((void * volatile *)(p), \
+                                          (void *)(n), (void *)(o)) == (void *)(o))
+   #define g_cas_32(p, o, n) \
+      (_InterlockedCompareExchange((long volatile *)(p), \
+                                   (long)(n), (long)(o)) == (long)(o))
+#else
+   #define g_cas_ptr(p, o, n) __sync_bool_compare_and_swap((p), (o), (n))
+   #define g_cas_32(p, o, n) __sync_bool_compare_and_swap((p), (o), (n))
+#endif
@@ -32,6 +32,15 @@ Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
 #include <string.h>
 #include <limits.h>
 #include <iostream>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <chrono>
+#include <unordered_map>
+#if defined(__AVX2__) && defined(__GNUC__)
+#include <immintrin.h>
+#define QLIFEAVX2
+#endif
 using namespace std ;
 /*
  *   The ai array is used to figure out the index number of the bit set in
@@ -88,16 +97,49 @@ static int bricks, tiles, supertiles, rcc, dq, ds, rccs, dqs, dss ;
 #else
 #define STAT(a)
 #endif
+/*
+ *   With more than one thread, dogen() recomputes the subtrees at level
+ *   SPLITLEV as separate tasks (see dogenpar()).  A subtree only writes
+ *   to itself, and only reads the subtrees passed in as its edge, par,
+ *   and cor neighbors, which the serial walk always finishes first; so
+ *   a task waits for those of its neighbors that are also tasks, and
+ *   the result is exactly what the serial walk computes.
+ *
+ *   Each thread allocates from its own free lists while the tasks run,
+ *   taking chunks from the shared ones under the pool lock.  Only the
+ *   main thread calls the poller.
+ */
+struct qlifeworker {
+   qlifeworker() : bricklist(0), tilelist(0), supertilelist(0), ismain(0) {}
+   linkedmem *bricklist, *tilelist, *supertilelist ;
+   int ismain ;
+} ;
+static thread_local qlifeworker *curworker ;
+/*
+ *   Supertiles at this level are the tasks; 256x256 cells each.
+ */
+const int SPLITLEV = 2 ;
+/*
+ *   With fewer tasks than this per thread, the main thread does them all
+ *   itself; waking everyone up costs more than it saves.
+ */
+const size_t MINTASKS = 2 ;
+/*
+ *   How many structures a thread takes from a shared free list at once.
+ */
+const int FREECHUNK = 64 ;
 /*
  *   If we need a new empty brick, we call this.  This structure is guaranteed
  *   to be all zeros.
  */
 brick *qlifealgo::newbrick() {
    brick *r ;
-   if (bricklist == 0)
-      bricklist = filllist(sizeof(brick)) ;
-   r = (brick *)(bricklist) ;
-   bricklist = bricklist->next ;
+   linkedmem *&list = curworker ? curworker->bricklist : bricklist ;
+   if (list == 0)
+      list = curworker ? takelist(bricklist, sizeof(brick))
+                       : filllist(sizeof(brick)) ;
+   r = (brick *)(list) ;
+   list = list->next ;
    memset(r, 0, sizeof(brick)) ;
    STAT(bricks++) ;
    return r ;
@@ -108,10 +150,12 @@ brick *qlifealgo::newbrick() {
  */
 tile *qlifealgo::newtile() {
    tile *r ;
-   if (tilelist == 0)
-      tilelist = filllist(sizeof(tile)) ;
-   r = (tile *)(tilelist) ;
-   tilelist = tilelist->next ;
+   linkedmem *&list = curworker ? curworker->tilelist : tilelist ;
+   if (list == 0)
+      list = curworker ? takelist(tilelist, sizeof(tile))
+                       : filllist(sizeof(tile)) ;
+   r = (tile *)(list) ;
+   list = list->next ;
    r->b[0] = r->b[1] = r->b[2] = r->b[3] = emptybrick ;
    r->flags = -1 ;
    STAT(tiles++) ;
@@ -123,10 +167,12 @@ tile *qlifealgo::newtile() {
  */
 supertile *qlifealgo::newsupertile(int lev) {
    supertile *r ;
-   if (supertilelist == 0)
-      supertilelist = filllist(sizeof(supertile)) ;
-   r = (supertile *)supertilelist ;
-   supertilelist = supertilelist->next ;
+   linkedmem *&list = curworker ? curworker->supertilelist : supertilelist ;
+   if (list == 0)
+      list = curworker ? takelist(supertilelist, sizeof(supertile))
+                       : filllist(sizeof(supertile)) ;
+   r = (supertile *)list ;
+   list = list->next ;
    r->d[0] = r->d[1] = r->d[2] = r->d[3] = r->d[4] = r->d[5] =
                                  r->d[6] = r->d[7] = nullroots[lev-1] ;
    STAT(supertiles++) ;
@@ -218,6 +264,8 @@ qlifealgo::qlifealgo() {
       lifefatal("bad platform for this program") ;
    memused = 0 ;
    maxmemory = 0 ;
+   pool = 0 ;
+   slicebirth = slicesurvive = -1 ;
    clearall() ;
 }
 /*
@@ -262,6 +310,8 @@ void qlifealgo::clearall() {
  *   This subroutine frees a universe.
  */
 qlifealgo::~qlifealgo() {
+   if (pool)
+      stopthreads() ;
    while (memused) {
       linkedmem *nu = memused->next ;
       free(memused) ;
@@ -323,7 +373,8 @@ int qlifealgo::doquad01(supertile *zis, supertile *edge,
  *   Note that the parallel and corner have already been recomputed so
  *   their changing bits are shifted up 10 positions in c.
  */
-   poller->poll() ;
+   if (curworker == 0 || curworker->ismain)
+      poller->poll() ;
    int changing = (zis->flags | (par->flags >> 19) |
                    (((edge->flags >> 18) | (cor->flags >> 27)) & 1)) & 0xff ;
    int x, b, nchanging = (zis->flags & 0x3ff00) << 10 ;
@@ -388,7 +439,8 @@ int qlifealgo::doquad01(supertile *zis, supertile *edge,
  */
 int qlifealgo::doquad10(supertile *zis, supertile *edge,
                         supertile *par, supertile *cor, int lev) {
-   poller->poll() ;
+   if (curworker == 0 || curworker->ismain)
+      poller->poll() ;
    int changing = (zis->flags | (par->flags >> 19) |
                    (((edge->flags >> 18) | (cor->flags >> 27)) & 1)) & 0xff ;
    int x, b, nchanging = (zis->flags & 0x3ff00) << 10 ;
@@ -426,6 +478,86 @@ int qlifealgo::doquad10(supertile *zis, supertile *edge,
    zis->flags = nchanging | 0xf0000000 ;
    return upchanging(nchanging) ;
 }
+/*
+ *   When the rule only depends on how many neighbors a cell has (see
+ *   totalisticmasks() in liferules.h), slicebirth and slicesurvive are
+ *   set, and with AVX2, rather than doing 64 table lookups per brick, we
+ *   compute all eight slices of a brick at once in a register by adding
+ *   up neighbors with bitwise operations.  p01() and p10() then just
+ *   take the slices they need, so the changing bookkeeping is exactly
+ *   what it was.  (Without AVX2 doing it four slices at a time is no
+ *   faster than the table, so we don't.)
+ */
+#ifdef QLIFEAVX2
+#define sl32(v, n) _mm256_slli_epi32(v, n)
+#define sr32(v, n) _mm256_srli_epi32(v, n)
+static inline __m256i mask32(unsigned int m) {
+   return _mm256_set1_epi32((int)m) ;
+}
+/*
+ *   Compute d[8..15] of b from d[0..7] of b and its neighbors to the
+ *   right, below, and below right.  Each new cell is the old one down
+ *   and to the right; shifting left brings the cells to the right of it
+ *   into line, and shifting a row (four bits) left brings those below.
+ */
+static void brickgen01(brick *b, brick *rb, brick *db, brick *rdb,
+                       unsigned int *nv, int birth, int survive) {
+   __m256i z = _mm256_loadu_si256((const __m256i *)b->d) ;
+   __m256i d = _mm256_loadu_si256((const __m256i *)db->d) ;
+   __m256i r = _mm256_insert_epi32(
+          _mm256_loadu_si256((const __m256i *)(b->d + 1)), (int)rb->d[0], 7) ;
+   __m256i dr = _mm256_insert_epi32(
+          _mm256_loadu_si256((const __m256i *)(db->d + 1)), (int)rdb->d[0], 7) ;
+   __m256i z1 = (sl32(z, 1) & mask32(0xeeeeeeee)) |
+                (sr32(r, 3) & mask32(0x11111111)) ;
+   __m256i z2 = (sl32(z, 2) & mask32(0xcccccccc)) |
+                (sr32(r, 2) & mask32(0x33333333)) ;
+   __m256i d1 = (sl32(d, 1) & mask32(0xeeeeeeee)) |
+                (sr32(dr, 3) & mask32(0x11111111)) ;
+   __m256i d2 = (sl32(d, 2) & mask32(0xcccccccc)) |
+                (sr32(dr, 2) & mask32(0x33333333)) ;
+   __m256i zl = z ^ z1 ^ z2, zh = (z & z1) | ((z ^ z1) & z2) ;
+   __m256i dl = d ^ d1 ^ d2, dh = (d & d1) | ((d ^ d1) & d2) ;
+   __m256i zs = z ^ z2, zc = z & z2, ds = d ^ d2, dc = d & d2 ;
+   _mm256_storeu_si256((__m256i *)nv,
+      totalisticnext(sl32(z1, 4) | sr32(d1, 28), zl, zh,
+                     sl32(zl, 8) | sr32(dl, 24), sl32(zh, 8) | sr32(dh, 24),
+                     sl32(zs, 4) | sr32(ds, 28), sl32(zc, 4) | sr32(dc, 28),
+                     birth, survive)) ;
+}
+/*
+ *   The mirror image:  compute d[0..7] of b from d[8..15] of b and its
+ *   neighbors to the left, above, and above left.
+ */
+static void brickgen10(brick *b, brick *lb, brick *ub, brick *lub,
+                       unsigned int *nv, int birth, int survive) {
+   __m256i z = _mm256_loadu_si256((const __m256i *)(b->d + 8)) ;
+   __m256i u = _mm256_loadu_si256((const __m256i *)(ub->d + 8)) ;
+   __m256i l = _mm256_insert_epi32(
+          _mm256_loadu_si256((const __m256i *)(b->d + 7)), (int)lb->d[15], 0) ;
+   __m256i lu = _mm256_insert_epi32(
+          _mm256_loadu_si256((const __m256i *)(ub->d + 7)), (int)lub->d[15], 0) ;
+   __m256i z1 = (sr32(z, 1) & mask32(0x77777777)) |
+                (sl32(l, 3) & mask32(0x88888888)) ;
+   __m256i z2 = (sr32(z, 2) & mask32(0x33333333)) |
+                (sl32(l, 2) & mask32(0xcccccccc)) ;
+   __m256i u1 = (sr32(u, 1) & mask32(0x77777777)) |
+                (sl32(lu, 3) & mask32(0x88888888)) ;
+   __m256i u2 = (sr32(u, 2) & mask32(0x33333333)) |
+                (sl32(lu, 2) & mask32(0xcccccccc)) ;
+   __m256i zl = z ^ z1 ^ z2, zh = (z & z1) | ((z ^ z1) & z2) ;
+   __m256i ul = u ^ u1 ^ u2, uh = (u & u1) | ((u ^ u1) & u2) ;
+   __m256i zs = z ^ z2, zc = z & z2, us = u ^ u2, uc = u & u2 ;
+   _mm256_storeu_si256((__m256i *)nv,
+      totalisticnext(sr32(z1, 4) | sl32(u1, 28),
+                     sr32(zl, 8) | sl32(ul, 24), sr32(zh, 8) | sl32(uh, 24),
+                     zl, zh,
+                     sr32(zs, 4) | sl32(us, 28), sr32(zc, 4) | sl32(uc, 28),
+                     birth, survive)) ;
+}
+#undef sl32
+#undef sr32
+#endif
 /*
  *   This is our monster subroutine that, with its mirror below, accounts for
  *   about 90% of the runtime.  It handles recomputation for a 32x32 tile.
@@ -461,6 +593,12 @@ int qlifealgo::p01(tile *p, tile *pr, tile *pd, tile *prd) {
          p->flags |= 1 << i ;
          if (b == emptybrick)
             p->b[i] = b = newbrick() ;
+#ifdef QLIFEAVX2
+         unsigned int nv[8] ;
+         int usevec = (slicebirth >= 0) ;
+         if (usevec)
+            brickgen01(b, rb, db, rdb, nv, slicebirth, slicesurvive) ;
+#endif
 /*
  *   If we need to recompute the end slice, now is a good time to get the
  *   right neighbor's data.
@@ -499,7 +637,13 @@ int qlifealgo::p01(tile *p, tile *pr, tile *pd, tile *prd) {
                                         ((traildata >> 2) & 0x33333333) ;
                unsigned int otherunderdata = ((underdata << 2) & 0xcccccccc) +
                                     ((trailunderdata >> 2) & 0x33333333) ;
-               int newv = (ruletable[zisdata >> 16] << 26) +
+               int newv ;
+#ifdef QLIFEAVX2
+               if (usevec)
+                  newv = nv[j] ;
+               else
+#endif
+               newv = (ruletable[zisdata >> 16] << 26) +
                           (ruletable[underdata >> 16] << 18) +
                           (ruletable[zisdata & 0xffff] << 10) +
                           (ruletable[underdata & 0xffff] << 2) +
@@ -586,6 +730,12 @@ int qlifealgo::p10(tile *plu, tile *pu, tile *pl, tile *p) {
          p->flags |= 1 << i ;
          if (b == emptybrick)
             p->b[i] = b = newbrick() ;
+#ifdef QLIFEAVX2
+         unsigned int nv[8] ;
+         int usevec = (slicebirth >= 0) ;
+         if (usevec)
+            brickgen10(b, lb, ub, lub, nv, slicebirth, slicesurvive) ;
+#endif
          if (recomp & 1) {
             j = 0 ;
             traildata = lb->d[15] ;
@@ -605,7 +755,13 @@ int qlifealgo::p10(tile *plu, tile *pu, tile *pl, tile *p) {
                                         ((traildata << 2) & 0xcccccccc) ;
                unsigned int otheroverdata = ((overdata >> 2) & 0x33333333) +
                                     ((trailoverdata << 2) & 0xcccccccc) ;
-               int newv = (ruletable[otheroverdata >> 16] << 26) +
+               int newv ;
+#ifdef QLIFEAVX2
+               if (usevec)
+                  newv = nv[j] ;
+               else
+#endif
+               newv = (ruletable[otheroverdata >> 16] << 26) +
                           (ruletable[otherdata >> 16] << 18) +
                           (ruletable[otheroverdata & 0xffff] << 10) +
                           (ruletable[otherdata & 0xffff] << 2) +
@@ -1087,6 +1243,280 @@ int qlifealgo::uproot_needed() {
          return 1 ;
    return 0 ;
 }
+/*
+ *   The pool:  the tasks for this generation, in the order the serial
+ *   walk would do them, and the supertiles above them (frames), whose
+ *   changing bits we can only finish once their tasks are done.
+ */
+struct qlifetask {
+   supertile *zis, *edge, *par, *cor ;
+   int frame, shift ;     // where our changing bits go
+   int result ;
+   int waiting ;          // unfinished tasks we read from
+   int next[3], nnext ;   // tasks that read from us
+} ;
+struct qlifeframe {
+   supertile *zis ;
+   int nchanging, up, shift ;
+} ;
+struct qlifepool {
+   qlifepool(qlifealgo *a, int n) : algo(a), workers(n), unfinished(0),
+                                    quit(0) {
+      workers[0].ismain = 1 ;
+   }
+   qlifealgo *algo ;
+   vector<qlifeworker> workers ;   // workers[0] is the main thread
+   vector<std::thread> threads ;
+   vector<qlifetask> tasks ;
+   vector<qlifeframe> frames ;
+   vector<int> ready ;             // tasks with nothing left to wait for
+   std::unordered_map<supertile *, int> taskof ;
+   int odd ;                       // phase 1->0 rather than 0->1
+   int unfinished ;
+   std::mutex lock ;
+   std::condition_variable wake ;      // workers wait on this
+   std::condition_variable mainwake ;  // the main thread waits on this
+   int quit ;
+   void addtask(supertile *zis, supertile *edge, supertile *par,
+                supertile *cor, int frame, int shift) ;
+   void workermain(int i) ;
+   void runtask(std::unique_lock<std::mutex> &lk) ;
+   void run() ;
+} ;
+/*
+ *   Record a task, and which earlier tasks it has to wait for.
+ */
+void qlifepool::addtask(supertile *zis, supertile *edge, supertile *par,
+                        supertile *cor, int frame, int shift) {
+   qlifetask t ;
+   int i = (int)tasks.size() ;
+   t.zis = zis ;
+   t.edge = edge ;
+   t.par = par ;
+   t.cor = cor ;
+   t.frame = frame ;
+   t.shift = shift ;
+   t.result = 0 ;
+   t.waiting = 0 ;
+   t.nnext = 0 ;
+   supertile *reads[3] = { edge, par, cor } ;
+   for (int k=0; k<3; k++) {
+      std::unordered_map<supertile *, int>::iterator it = taskof.find(reads[k]) ;
+      if (it != taskof.end()) {
+         qlifetask &u = tasks[it->second] ;
+         u.next[u.nnext++] = i ;
+         t.waiting++ ;
+      }
+   }
+   taskof[zis] = i ;
+   tasks.push_back(t) ;
+}
+/*
+ *   The body of each worker thread:  run tasks until told to quit.
+ */
+void qlifepool::workermain(int i) {
+   curworker = &workers[i] ;
+   std::unique_lock<std::mutex> lk(lock) ;
+   while (!quit) {
+      if (ready.empty())
+         wake.wait(lk) ;
+      else
+         runtask(lk) ;
+   }
+}
+/*
+ *   Take the earliest ready task and run it, with the lock released in
+ *   the meantime; then release the tasks that were waiting on it.
+ */
+void qlifepool::runtask(std::unique_lock<std::mutex> &lk) {
+   size_t k = 0 ;
+   for (size_t j=1; j<ready.size(); j++)
+      if (ready[j] < ready[k])
+         k = j ;
+   int i = ready[k] ;
+   ready[k] = ready.back() ;
+   ready.pop_back() ;
+   lk.unlock() ;
+   qlifetask &t = tasks[i] ;
+   if (odd)
+      t.result = algo->doquad10(t.zis, t.edge, t.par, t.cor, SPLITLEV) ;
+   else
+      t.result = algo->doquad01(t.zis, t.edge, t.par, t.cor, SPLITLEV) ;
+   lk.lock() ;
+   int freed = 0 ;
+   for (int j=0; j<t.nnext; j++)
+      if (--tasks[t.next[j]].waiting == 0) {
+         ready.push_back(t.next[j]) ;
+         freed++ ;
+      }
+   if (freed > 1)
+      wake.notify_all() ;
+   else if (freed == 1)
+      wake.notify_one() ;
+   if (--unfinished == 0 || freed)
+      mainwake.notify_one() ;
+}
+/*
+ *   Main thread:  run all the tasks, helping out while we wait.
+ */
+void qlifepool::run() {
+   std::unique_lock<std::mutex> lk(lock) ;
+   unfinished = (int)tasks.size() ;
+   for (int i=0; i<(int)tasks.size(); i++)
+      if (tasks[i].waiting == 0)
+         ready.push_back(i) ;
+   wake.notify_all() ;
+   while (unfinished > 0) {
+      if (!ready.empty()) {
+         runtask(lk) ;
+      } else if (mainwake.wait_for(lk, std::chrono::milliseconds(10)) ==
+                                                  std::cv_status::timeout) {
+         // keep the user interface alive while the workers grind
+         lk.unlock() ;
+         algo->poller->inner_poll() ;
+         lk.lock() ;
+      }
+   }
+}
+/*
+ *   Our private free list ran out; take a chunk of the shared one.
+ */
+linkedmem *qlifealgo::takelist(linkedmem *&list, int size) {
+   std::unique_lock<std::mutex> lk(pool->lock) ;
+   if (list == 0)
+      list = filllist(size) ;
+   linkedmem *first = list, *last = first ;
+   for (int i=1; i<FREECHUNK && last->next; i++)
+      last = last->next ;
+   list = last->next ;
+   last->next = 0 ;
+   return first ;
+}
+void qlifealgo::setThreads(int n) {
+   poller->bailIfCalculating() ;
+   lifealgo::setThreads(n) ;
+   if (pool && (int)pool->workers.size() != numthreads)
+      stopthreads() ;
+}
+void qlifealgo::startthreads() {
+   pool = new qlifepool(this, numthreads) ;
+   for (int i=1; i<numthreads; i++)
+      pool->threads.push_back(std::thread(&qlifepool::workermain, pool, i)) ;
+}
+void qlifealgo::stopthreads() {
+   {
+      std::unique_lock<std::mutex> lk(pool->lock) ;
+      pool->quit = 1 ;
+      pool->wake.notify_all() ;
+   }
+   for (size_t i=0; i<pool->threads.size(); i++)
+      pool->threads[i].join() ;
+   delete pool ;
+   pool = 0 ;
+}
+/*
+ *   The same walk as doquad01() and doquad10(), for the levels above
+ *   SPLITLEV:  it records the supertiles at SPLITLEV that need to be
+ *   recomputed as tasks instead of recomputing them.  Our neighbors only
+ *   look at the changing bits we carried over from the last generation
+ *   (bits 18 and up), so we can set those now and the rest once the
+ *   tasks are done.
+ */
+void qlifealgo::plansplit(supertile *zis, supertile *edge, supertile *par,
+                          supertile *cor, int lev, int up, int shift) {
+   int odd = pool->odd ;
+   int changing = (zis->flags | (par->flags >> 19) |
+                   (((edge->flags >> 18) | (cor->flags >> 27)) & 1)) & 0xff ;
+   int x, b, f = (int)pool->frames.size() ;
+   supertile *p, *pf, *pu, *pfu ;
+   qlifeframe fr ;
+   fr.zis = zis ;
+   fr.nchanging = (zis->flags & 0x3ff00) << 10 ;
+   fr.up = up ;
+   fr.shift = shift ;
+   pool->frames.push_back(fr) ;
+   if (changing & 1) {
+      x = odd ? 0 : 7 ;
+      b = 1 ;
+      pf = edge->d[7 - x] ;
+      pfu = cor->d[7 - x] ;
+   } else {
+      b = (changing & - changing) ;
+      x = odd ? ai[b] : 7 - ai[b] ;
+      pf = zis->d[odd ? x - 1 : x + 1] ;
+      pfu = par->d[odd ? x - 1 : x + 1] ;
+   }
+   for (;;) {
+      p = zis->d[x] ;
+      pu = par->d[x] ;
+      if (changing & b) {
+         if (p == nullroots[lev-1])
+            p = zis->d[x] = newsupertile(lev-1) ;
+         if (lev - 1 == SPLITLEV)
+            pool->addtask(p, pu, pf, pfu, f, odd ? 7 - x : x) ;
+         else
+            plansplit(p, pu, pf, pfu, lev-1, f, odd ? 7 - x : x) ;
+         changing -= b ;
+      } else if (changing == 0)
+         break ;
+      b <<= 1 ;
+      x += odd ? 1 : -1 ;
+      pfu = pu ;
+      pf = p ;
+   }
+   zis->flags = pool->frames[f].nchanging | 0xf0000000 ;
+}
+/*
+ *   Recompute a generation with the pool:  plan, run the tasks, and
+ *   then finish the changing bits from the bottom up.  Last, give back
+ *   whatever is left on the threads' free lists.
+ */
+void qlifealgo::dogenpar() {
+   if (pool == 0)
+      startthreads() ;
+   pool->tasks.clear() ;
+   pool->frames.clear() ;
+   pool->taskof.clear() ;
+   pool->odd = generation.odd() ;
+   plansplit(root, nullroot, nullroot, nullroot, rootlev, -1, 0) ;
+   if (pool->tasks.size() < MINTASKS * pool->workers.size()) {
+      // not worth waking anyone up; do them in order ourselves
+      for (size_t i=0; i<pool->tasks.size(); i++) {
+         qlifetask &t = pool->tasks[i] ;
+         if (pool->odd)
+            t.result = doquad10(t.zis, t.edge, t.par, t.cor, SPLITLEV) ;
+         else
+            t.result = doquad01(t.zis, t.edge, t.par, t.cor, SPLITLEV) ;
+      }
+   } else {
+      curworker = &pool->workers[0] ;
+      pool->run() ;
+      curworker = 0 ;
+   }
+   for (size_t i=0; i<pool->tasks.size(); i++) {
+      qlifetask &t = pool->tasks[i] ;
+      pool->frames[t.frame].nchanging |= t.result << t.shift ;
+   }
+   for (int i=(int)pool->frames.size()-1; i>=0; i--) {
+      qlifeframe &fr = pool->frames[i] ;
+      fr.zis->flags = fr.nchanging | 0xf0000000 ;
+      if (fr.up >= 0)
+         pool->frames[fr.up].nchanging |= upchanging(fr.nchanging) << fr.shift ;
+   }
+   for (size_t i=0; i<pool->workers.size(); i++) {
+      qlifeworker &w = pool->workers[i] ;
+      linkedmem **lists[3] = { &w.bricklist, &w.tilelist, &w.supertilelist } ;
+      linkedmem **shared[3] = { &bricklist, &tilelist, &supertilelist } ;
+      for (int k=0; k<3; k++) {
+         while (*lists[k]) {
+            linkedmem *p = *lists[k] ;
+            *lists[k] = p->next ;
+            p->next = *shared[k] ;
+            *shared[k] = p ;
+         }
+      }
+   }
+}
 /*
  *   The new generation code is simple.  We uproot if needed.  Then, we call
  *   the appropriate top-level slice code depending on the generation number.
@@ -1107,7 +1537,9 @@ void qlifealgo::dogen() {
       while (uproot_needed())
          uproot() ;
    }
-   if (generation.odd())
+   if (numthreads > 1 && rootlev > SPLITLEV)
+      dogenpar() ;
+   else if (generation.odd())
       doquad10(root, nullroot, nullroot, nullroot, rootlev) ;
    else
       doquad01(root, nullroot, nullroot, nullroot, rootlev) ;
@@ -1131,12 +1563,19 @@ void qlifealgo::step() {
    while (t != 0) {
       if (qliferules.alternate_rules) {
          // emulate B0-not-Smax rule by changing rule table depending on gen parity
-         if (generation.odd())
+         if (generation.odd()) {
             ruletable = qliferules.rule1 ;
-         else
+            slicebirth = tablebirth[1] ;
+            slicesurvive = tablesurvive[1] ;
+         } else {
             ruletable = qliferules.rule0 ;
+            slicebirth = tablebirth[0] ;
+            slicesurvive = tablesurvive[0] ;
+         }
       } else {
          ruletable = qliferules.rule0 ;
+         slicebirth = tablebirth[0] ;
+         slicesurvive = tablesurvive[0] ;
       }
       dogen() ;
       if (poller->isInterrupted())
@@ -1187,8 +1626,18 @@ const char *qlifealgo::setrule(const char *s) {
       fliprule(qliferules.rule0);
    }
    
+   // see if the tables can be done with bitwise adders instead
+   for (int i=0; i<2; i++) {
+      char *table = (i && qliferules.alternate_rules) ? qliferules.rule1
+                                                      : qliferules.rule0 ;
+      if (!liferules::totalisticmasks(table, tablebirth[i], tablesurvive[i]))
+         tablebirth[i] = tablesurvive[i] = -1 ;
+   }
+   
    // ruletable is set in step(), but play safe
    ruletable = qliferules.rule0 ;
+   slicebirth = tablebirth[0] ;
+   slicesurvive = tablesurvive[0] ;
    
    if (qliferules.isHexagonal())
       grid_type = HEX_GRID;
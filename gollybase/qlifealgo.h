@@ -173,6 +173,11 @@ struct supertile { /* 44 bytes */
 struct linkedmem {
    struct linkedmem *next ;
 } ;
+/*
+ *   The worker pool for multithreaded stepping; only used inside
+ *   qlifealgo.cpp.
+ */
+struct qlifepool ;
 /*
  *   This structure contains all of our variables that pertain to a
  *   particular universe.  (Thus, we support multiple universes.)
@@ -229,6 +234,7 @@ public:
    virtual int hyperCapable() { return 0 ; }
    virtual void setMaxMemory(int m) ;
    virtual int getMaxMemory() { return (int)(maxmemory >> 20) ; }
+   virtual void setThreads(int n) ;
    virtual const char *setrule(const char *s) ;
    virtual const char *getrule() { return qliferules.getrule() ; }
    virtual void step() ;
@@ -244,6 +250,7 @@ public:
    static void doInitializeAlgoInfo(staticAlgoInfo &) ;
 private:
    linkedmem *filllist(int size) ;
+   linkedmem *takelist(linkedmem *&list, int size) ;
    brick *newbrick() ;
    tile *newtile() ;
    supertile *newsupertile(int lev) ;
@@ -260,6 +267,18 @@ private:
    G_INT64 popcount() ;
    int uproot_needed() ;
    void dogen() ;
+/*
+ *   With more than one thread, dogen() walks the top of the tree itself
+ *   and hands the supertiles at a lower level to the pool (see
+ *   qlifepool in qlifealgo.cpp).
+ */
+   friend struct qlifepool ;
+   qlifepool *pool ;
+   void startthreads() ;
+   void stopthreads() ;
+   void dogenpar() ;
+   void plansplit(supertile *zis, supertile *edge, supertile *par,
+                  supertile *cor, int lev, int up, int shift) ;
    void renderbm(int x, int y) ;
    void renderbm(int x, int y, int xsize, int ysize) ;
    void BlitCells(supertile *p, int xoff, int yoff, int wd, int ht, int lev) ;
@@ -289,6 +308,10 @@ private:
    int cleandowncounter ;
    g_uintptr_t maxmemory, usedmemory ;
    char *ruletable ;
+   // bit n set if a cell with n neighbors is born or survives, for rule0,
+   // rule1, and whichever one ruletable is; -1 if that table can't be
+   // done that way (see brickgen01() in qlifealgo.cpp)
+   int tablebirth[2], tablesurvive[2], slicebirth, slicesurvive ;
    // when drawing, these are used
    liferender *renderer ;
    viewport *view ;
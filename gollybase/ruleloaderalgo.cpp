@@ -228,6 +228,14 @@ state ruleloaderalgo::slowcalc(state nw, state n, state ne, state w, state c,
         return LocalRuleTree->slowcalc(nw, n, ne, w, c, e, sw, s, se);
 }
 
+void ruleloaderalgo::slowcalc4(const state *b, state *r)
+{
+    if (rule_type == TABLE)
+        LocalRuleTable->slowcalc4(b, r);
+    else // rule_type == TREE
+        LocalRuleTree->slowcalc4(b, r);
+}
+
 static lifealgo* creator()
 {
     return new ruleloaderalgo();
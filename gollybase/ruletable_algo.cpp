@@ -260,6 +260,29 @@ string ruletable_algo::LoadRuleTable(string rule)
       line_reader.setcloseonfree(); // make sure it goes away if we return with an error
    }
 
+   // read all the table's lines first; if we've loaded the same text
+   // before then its compiled tables can be used again as they are
+   vector<string> lines;
+   for (;;)
+   {
+      if (isDefaultRule) {
+         if (defaultRuleData[lines.size()] == 0)
+            break;
+         lines.push_back(defaultRuleData[lines.size()]);
+      } else {
+         if (!line_reader.fgets(line_buffer,MAX_LINE_LEN))
+            break;
+         if (static_rulefile && line_buffer[0] == static_endchar)
+            break;
+         lines.push_back(line_buffer);
+      }
+   }
+   string text;
+   for(unsigned int i=0;i<lines.size();i++)
+      text += lines[i] + "\n";
+   if(FindCachedTable(text))
+      return string(""); // success
+
    string symmetries = "rotate4"; // default
    TNeighborhood neighborhood = vonNeumann;  // default
    unsigned int n_states = 8;  // default
@@ -270,19 +293,9 @@ string ruletable_algo::LoadRuleTable(string rule)
    // these line must have been read before the rest of the file
    bool n_states_parsed=false,neighborhood_parsed=false,symmetries_parsed=false;
 
-   for (;;) 
+   for (unsigned int iLine=0;iLine<lines.size();iLine++) 
    {
-      if (isDefaultRule) {
-         if (defaultRuleData[lineno] == 0)
-            break;
-         line = defaultRuleData[lineno];
-      } else {
-         if (!line_reader.fgets(line_buffer,MAX_LINE_LEN))
-            break;
-         if (static_rulefile && line_buffer[0] == static_endchar)
-            break;
-         line = line_buffer;
-      }
+      line = lines[iLine];
       lineno++;
       // snip off any trailing comment
       if(line.find('#')!=string::npos)
@@ -553,10 +566,64 @@ string ruletable_algo::LoadRuleTable(string rule)
    this->neighborhood = neighborhood;
    this->n_states = n_states;
    PackTransitions(symmetries,n_inputs,transition_table);
+   CompileTransitions(n_inputs);
+   CacheTable(text);
 
    return string(""); // success
 }
 
+// the last few tables loaded, keyed by their text, so that going back to
+// a rule (or loading a pattern, which sets the default rule first) needs
+// neither parsing nor compiling
+struct ruletable_cachedtable {
+   string text;
+   unsigned int n_states;
+   ruletable_algo::TNeighborhood neighborhood;
+   lifealgo::TGridType grid_type;
+   vector< vector< vector<ruletable_algo::TBits> > > lut;
+   unsigned int n_compressed_rules;
+   vector<state> output;
+   vector<int> dd_a;
+   vector<state> dd_b;
+   int dd_base;
+};
+static vector<ruletable_cachedtable> tablecache;
+static unsigned int tablecachenext = 0;
+static const unsigned int TABLECACHESIZE = 8;
+
+bool ruletable_algo::FindCachedTable(const string& text)
+{
+   for(unsigned int i=0;i<tablecache.size();i++)
+   {
+      const ruletable_cachedtable& t = tablecache[i];
+      if(t.text == text)
+      {
+         this->n_states = t.n_states;
+         this->neighborhood = t.neighborhood;
+         this->grid_type = t.grid_type;
+         this->lut = t.lut;
+         this->n_compressed_rules = t.n_compressed_rules;
+         this->output = t.output;
+         this->dd_a = t.dd_a;
+         this->dd_b = t.dd_b;
+         this->dd_base = t.dd_base;
+         return true;
+      }
+   }
+   return false;
+}
+
+void ruletable_algo::CacheTable(const string& text)
+{
+   ruletable_cachedtable t = { text, this->n_states, this->neighborhood, this->grid_type,
+      this->lut, this->n_compressed_rules, this->output, this->dd_a, this->dd_b, this->dd_base };
+   if(tablecache.size() < TABLECACHESIZE)
+      tablecache.push_back(t);
+   else
+      tablecache[tablecachenext] = t;
+   tablecachenext = (tablecachenext + 1) % TABLECACHESIZE;
+}
+
 // convert transition table to bitmask lookup
 void ruletable_algo::PackTransitions(const string& symmetries, int n_inputs,
                             const vector< pair< vector< vector<state> >, state > >& transition_table)
@@ -685,6 +752,275 @@ void ruletable_algo::PackTransition(const vector< vector<state> > & inputs,
     }
 }
 
+// the decision diagram is hash-consed:  keys of a fixed length are
+// stored end to end in one flat array and found through an open-addressed
+// table of their indices, each with an int value
+template <class T> class ddtable {
+public:
+   ddtable(unsigned int keylen) : len(keylen), slots(256, -1) {}
+   int get(const T* k) const
+   {
+      size_t mask = slots.size()-1;
+      for(size_t i = hash(k) & mask; slots[i] >= 0; i = (i+1) & mask)
+         if(same(k, slots[i]))
+            return vals[slots[i]];
+      return -1;
+   }
+   void put(const T* k, int v)
+   {
+      if(2*(vals.size()+1) > slots.size())
+         grow();
+      size_t mask = slots.size()-1, i = hash(k) & mask;
+      while(slots[i] >= 0)
+         i = (i+1) & mask;
+      slots[i] = (int)vals.size();
+      keys.insert(keys.end(), k, k+len);
+      vals.push_back(v);
+   }
+   size_t size() const { return vals.size(); }
+   const T* key(size_t i) const { return keys.data() + i*len; }
+   int value(size_t i) const { return vals[i]; }
+private:
+   size_t hash(const T* k) const
+   {
+      unsigned long long h = len;
+      for(unsigned int i=0;i<len;i++)
+         h = (h + (unsigned long long)k[i]) * 0x9e3779b97f4a7c15ULL;
+      return (size_t)(h ^ (h >> 29));
+   }
+   bool same(const T* k, int i) const
+   {
+      const T* p = keys.data() + (size_t)i*len;
+      for(unsigned int j=0;j<len;j++)
+         if(k[j] != p[j])
+            return false;
+      return true;
+   }
+   void grow()
+   {
+      slots.assign(slots.size()*2, -1);
+      size_t mask = slots.size()-1;
+      for(size_t n=0;n<vals.size();n++)
+      {
+         size_t i = hash(key(n)) & mask;
+         while(slots[i] >= 0)
+            i = (i+1) & mask;
+         slots[i] = (int)n;
+      }
+   }
+   unsigned int len;
+   vector<T> keys;
+   vector<int> vals;
+   vector<int> slots;
+};
+
+// builds the decision diagram for a packed table, reading the cells in
+// the given order of lut indices with the centre cell (0) last; a cell
+// given as -1 is one the neighborhood doesn't have, which every rule
+// matches whatever its state
+class ruletable_ddbuilder {
+public:
+   ruletable_ddbuilder(const ruletable_algo& rt, const int* order, int n_vars);
+   int Build();
+   void WriteTree(ostream& os, int n_neighbors);
+
+   vector<int> a;       // nodes of n_states offsets into a, or into b for the last
+   vector<state> b;     // nodes of n_states outputs, indexed by the centre cell
+private:
+   int Node(int iVar, const ruletable_algo::TBits* matching);
+
+   const ruletable_algo& rt;
+   const int* order;
+   int n_vars;
+   vector< ddtable<ruletable_algo::TBits> > memo;   // per level, by the rules still matching
+   vector< ddtable<int> > a_nodes;                  // per level, by the children
+   ddtable<state> b_nodes;
+   vector< vector<ruletable_algo::TBits> > scratch; // per level
+};
+
+ruletable_ddbuilder::ruletable_ddbuilder(const ruletable_algo& rt, const int* order, int n_vars)
+   : rt(rt), order(order), n_vars(n_vars),
+     memo(n_vars, ddtable<ruletable_algo::TBits>(rt.n_compressed_rules)),
+     a_nodes(n_vars, ddtable<int>(rt.n_states)), b_nodes(rt.n_states),
+     scratch(n_vars, vector<ruletable_algo::TBits>(rt.n_compressed_rules))
+{
+}
+
+// the offset of the root node, or -1 if the diagram would have more
+// than MAX_DD_SIZE entries
+int ruletable_ddbuilder::Build()
+{
+   vector<ruletable_algo::TBits> all(rt.n_compressed_rules, ~(ruletable_algo::TBits)0);
+   return Node(0, all.data());
+}
+
+// the node for the cells from iVar on, given the rules still matching
+int ruletable_ddbuilder::Node(int iVar, const ruletable_algo::TBits* matching)
+{
+   int result = memo[iVar].get(matching);
+   if(result >= 0)
+      return result;
+   if(a.size() + b.size() > ruletable_algo::MAX_DD_SIZE)
+      return -1;
+   unsigned int n_states = rt.n_states, n_rc = rt.n_compressed_rules;
+   if(iVar == n_vars-1)
+   {
+      // the centre cell: the output of the first rule that still
+      // matches, or no change
+      vector<state> outputs(n_states);
+      for(unsigned int c=0;c<n_states;c++)
+      {
+         outputs[c] = (state)c;
+         for(unsigned int iRuleC=0;iRuleC<n_rc;iRuleC++)
+         {
+            ruletable_algo::TBits is_match = matching[iRuleC] & rt.lut[0][c][iRuleC];
+            if(is_match)
+            {
+               unsigned int iBit=0;
+               while(!(is_match & ((ruletable_algo::TBits)1 << iBit)))
+                  ++iBit;
+               outputs[c] = rt.output[ iRuleC*sizeof(ruletable_algo::TBits)*8 + iBit ];
+               break;
+            }
+         }
+      }
+      result = b_nodes.get(outputs.data());
+      if(result < 0)
+      {
+         result = (int)b.size();
+         b.insert(b.end(),outputs.begin(),outputs.end());
+         b_nodes.put(outputs.data(),result);
+      }
+   }
+   else
+   {
+      vector<int> children(n_states);
+      int iInput = order[iVar];
+      ruletable_algo::TBits* m = scratch[iVar].data();
+      for(unsigned int v=0;v<n_states;v++)
+      {
+         if(iInput < 0)
+         {
+            // not in the neighborhood, so the same for every state
+            if(v == 0)
+               children[v] = Node(iVar+1, matching);
+            else
+               children[v] = children[0];
+         }
+         else
+         {
+            for(unsigned int iRuleC=0;iRuleC<n_rc;iRuleC++)
+               m[iRuleC] = matching[iRuleC] & rt.lut[iInput][v][iRuleC];
+            children[v] = Node(iVar+1, m);
+         }
+         if(children[v] < 0)
+            return -1;
+      }
+      result = a_nodes[iVar].get(children.data());
+      if(result < 0)
+      {
+         result = (int)a.size();
+         a.insert(a.end(),children.begin(),children.end());
+         a_nodes[iVar].put(children.data(),result);
+      }
+   }
+   memo[iVar].put(matching,result);
+   return result;
+}
+
+// write the diagram in the @TREE format:  the nodes for the centre cell
+// are level 1 and come first, numbered in the order they are in b, and
+// then each level up in turn, so the root comes last
+void ruletable_ddbuilder::WriteTree(ostream& os, int n_neighbors)
+{
+   unsigned int n_states = rt.n_states;
+   size_t n_b = b.size() / n_states;
+   vector<int> id(a.size() / n_states);
+   size_t n_nodes = n_b;
+   for(int iVar=n_vars-2;iVar>=0;iVar--)
+      n_nodes += a_nodes[iVar].size();
+   os << "num_states=" << n_states << "\n";
+   os << "num_neighbors=" << n_neighbors << "\n";
+   os << "num_nodes=" << n_nodes << "\n";
+   for(size_t i=0;i<n_b;i++)
+   {
+      os << 1;
+      for(unsigned int c=0;c<n_states;c++)
+         os << " " << (int)b[i*n_states+c];
+      os << "\n";
+   }
+   int next = (int)n_b;
+   for(int iVar=n_vars-2;iVar>=0;iVar--)
+   {
+      for(size_t i=0;i<a_nodes[iVar].size();i++)
+      {
+         const int* children = a_nodes[iVar].key(i);
+         os << n_vars-iVar;
+         for(unsigned int v=0;v<n_states;v++)
+         {
+            int child = children[v] / (int)n_states;
+            os << " " << (iVar == n_vars-2 ? child : id[child]);
+         }
+         os << "\n";
+         id[a_nodes[iVar].value(i) / n_states] = next++;
+      }
+   }
+}
+
+// compile the packed transitions into a decision diagram of the kind
+// ruletreealgo reads from a .tree file, so a lookup is one array load
+// per neighbor instead of a scan over all the rules; each node has one
+// entry per state and is reached through the cells in lut order, with
+// the centre cell last
+void ruletable_algo::CompileTransitions(int n_inputs)
+{
+   vector<int> order;
+   for(int i=1;i<n_inputs;i++)
+      order.push_back(i);
+   order.push_back(0);
+   ruletable_ddbuilder builder(*this, order.data(), n_inputs);
+   int base = builder.Build();
+   if(base < 0)
+   {
+      // too big; slowcalc() will scan the rules instead
+      this->dd_a.clear();
+      this->dd_b.clear();
+   }
+   else
+   {
+      this->dd_a.swap(builder.a);
+      this->dd_b.swap(builder.b);
+   }
+   this->dd_base = base;
+}
+
+// write the table as a rule tree, in the format ruletreealgo reads;
+// neighborhoods other than vonNeumann become Moore, with the cells they
+// don't have ignored
+const char* ruletable_algo::WriteTree(ostream& os)
+{
+   // the tree reads nw,ne,sw,se,n,w,e,s,c (or n,w,e,s,c); these are
+   // the lut indices of those cells
+   static const int vn_order[5] = {1,4,2,3,0};                   // c,n,e,s,w
+   static const int moore_order[9] = {8,2,6,4,1,7,3,5,0};        // c,n,ne,e,se,s,sw,w,nw
+   static const int hex_order[9] = {6,-1,-1,3,1,5,2,4,0};        // c,n,e,se,s,w,nw
+   static const int oned_order[9] = {-1,-1,-1,-1,-1,1,2,-1,0};   // c,w,e
+   const int* order = moore_order;
+   int n_vars = 9;
+   switch(this->neighborhood)
+   {
+      case vonNeumann: order = vn_order; n_vars = 5; break;
+      case Moore: order = moore_order; break;
+      case hexagonal: order = hex_order; break;
+      case oneDimensional: order = oned_order; break;
+   }
+   ruletable_ddbuilder builder(*this, order, n_vars);
+   if(builder.Build() < 0)
+      return "Rule table too big to convert to a tree.";
+   builder.WriteTree(os, n_vars-1);
+   return NULL;
+}
+
 const char* ruletable_algo::getrule() {
    return this->current_rule.c_str();
 }
@@ -694,7 +1030,7 @@ const char* ruletable_algo::DefaultRule() {
 }
 
 ruletable_algo::ruletable_algo()
-   : n_states(8), neighborhood(vonNeumann), n_compressed_rules(0)
+   : n_states(8), neighborhood(vonNeumann), n_compressed_rules(0), dd_base(-1)
 {
    maxCellStates = n_states;
 }
@@ -707,6 +1043,24 @@ ruletable_algo::~ruletable_algo()
 state ruletable_algo::slowcalc(state nw, state n, state ne, state w, state c, state e,
                         state sw, state s, state se) 
 {
+   if(this->dd_base >= 0)
+   {
+      // walk the compiled decision diagram (see CompileTransitions)
+      const int *a = &this->dd_a[0];
+      const state *b = &this->dd_b[0];
+      switch(this->neighborhood)
+      {
+         case vonNeumann: // n,e,s,w then c
+            return b[a[a[a[a[this->dd_base+n]+e]+s]+w]+c];
+         case Moore: // n,ne,e,se,s,sw,w,nw then c
+            return b[a[a[a[a[a[a[a[a[this->dd_base+n]+ne]+e]+se]+s]+sw]+w]+nw]+c];
+         case hexagonal: // n,e,se,s,w,nw then c
+            return b[a[a[a[a[a[a[this->dd_base+n]+e]+se]+s]+w]+nw]+c];
+         case oneDimensional: // w,e then c
+            return b[a[a[this->dd_base+w]+e]+c];
+      }
+   }
+
    TBits is_match = 0;  // AKT: explicitly initialized to avoid gcc warning
 
    for(unsigned int iRuleC=0;iRuleC<this->n_compressed_rules;iRuleC++)
@@ -750,6 +1104,10 @@ state ruletable_algo::slowcalc(state nw, state n, state ne, state w, state c, st
    return c; // default: no change
 }
 
+void ruletable_algo::slowcalc4(const state *b, state *r) {
+   ghashslowcalc4(this, b, r) ;
+}
+
 static lifealgo *creator() { return new ruletable_algo(); }
 
 void ruletable_algo::doInitializeAlgoInfo(staticAlgoInfo &ai) 
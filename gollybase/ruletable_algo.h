@@ -31,6 +31,8 @@ Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
  *   An algo that takes a rule table.
  */
 class ruletable_algo : public ghashbase {
+   friend class ruletable_ddbuilder;
+   friend struct ruletable_cachedtable;
 
 public:
 
@@ -38,6 +40,7 @@ public:
    virtual ~ruletable_algo() ;
    virtual state slowcalc(state nw, state n, state ne, state w, state c,
                           state e, state sw, state s, state se) ;
+   virtual void slowcalc4(const state *b, state *r) ;
    virtual const char* setrule(const char* s) ;
    virtual const char* getrule() ;
    virtual const char* DefaultRule() ;
@@ -48,12 +51,19 @@ public:
    bool IsDefaultRule(const char* rulename);
    const char* LoadTable(FILE* rulefile, int lineno, char endchar, const char* s);
 
+   // write the loaded table as a rule tree, in the @TREE format;
+   // returns an error message or NULL
+   const char* WriteTree(std::ostream& os);
+
 protected:
 
    std::string LoadRuleTable(std::string filename);
    void PackTransitions(const std::string& symmetries, int n_inputs, 
                         const std::vector< std::pair< std::vector< std::vector<state> >, state> > & transition_table);
    void PackTransition(const std::vector< std::vector<state> > & inputs, state output);
+   void CompileTransitions(int n_inputs);
+   bool FindCachedTable(const std::string& text);
+   void CacheTable(const std::string& text);
                         
 protected:
 
@@ -69,5 +79,13 @@ protected:
    unsigned int n_compressed_rules;
    std::vector<state> output; // state output[n_rules];
 
+   // the same transitions compiled into a decision diagram (see
+   // CompileTransitions); dd_base is -1 if it would have had more than
+   // MAX_DD_SIZE entries, and then slowcalc() scans lut instead
+   static const unsigned int MAX_DD_SIZE = 1 << 22;
+   std::vector<int> dd_a; // nodes of n_states offsets into dd_a, or into dd_b for the last
+   std::vector<state> dd_b; // nodes of n_states outputs, indexed by the centre cell
+   int dd_base;
+
 };
 #endif
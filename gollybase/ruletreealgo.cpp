@@ -280,6 +280,10 @@ state ruletreealgo::slowcalc(state nw, state n, state ne, state w, state c, stat
      return b[a[a[a[a[a[a[a[a[base+nw]+ne]+sw]+se]+n]+w]+e]+s]+c] ;
 }
 
+void ruletreealgo::slowcalc4(const state *b, state *r) {
+   ghashslowcalc4(this, b, r) ;
+}
+
 static lifealgo *creator() { return new ruletreealgo() ; }
 
 void ruletreealgo::doInitializeAlgoInfo(staticAlgoInfo &ai) {
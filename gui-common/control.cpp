@@ -483,7 +483,8 @@ void StopGenerating()
 void NextGeneration(bool useinc)
 {
     lifealgo* curralgo = currlayer->algo;
-    bool boundedgrid = (curralgo->gridwd > 0 || curralgo->gridht > 0);
+    bool boundedgrid = (curralgo->gridwd > 0 || curralgo->gridht > 0) &&
+                       !curralgo->handlesBoundedGrid();
 
     if (generating) {
         // we were called via timer so StartGenerating has already checked
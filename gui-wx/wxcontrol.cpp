@@ -569,7 +569,7 @@ void MainFrame::DisplayPattern()
 bool MainFrame::StepPattern()
 {
     lifealgo* curralgo = currlayer->algo;
-    if (curralgo->gridwd > 0 || curralgo->gridht > 0) {
+    if ((curralgo->gridwd > 0 || curralgo->gridht > 0) && !curralgo->handlesBoundedGrid()) {
         // bounded grid, so temporarily set the increment to 1 so we can call
         // CreateBorderCells() and DeleteBorderCells() around each step()
         int savebase = currlayer->currbase;
@@ -1035,7 +1035,8 @@ void MainFrame::NextGeneration(bool useinc)
         viewptr->CheckCursor(infront);
     }
     
-    bool boundedgrid = (curralgo->gridwd > 0 || curralgo->gridht > 0);
+    bool boundedgrid = (curralgo->gridwd > 0 || curralgo->gridht > 0) &&
+                       !curralgo->handlesBoundedGrid();
     
     if (useinc) {
         // step by current increment